@@ -0,0 +1,203 @@
+// One source, built twice: keyq_benchmark against keyq and, when FFTW3 is installed,
+// fftw3_benchmark against FFTW3. The two libraries export the same symbols, so they can't
+// share a binary; benchmark names carry the library so the JSON reports line up.
+
+#include "perf_counters.h"
+
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef USE_REAL_FFTW3
+#include <fftw3.h>
+constexpr const char *library = "fftw3";
+#else
+#include "keyq.h"
+constexpr const char *library = "keyq";
+#endif
+
+namespace {
+
+// The fftw_ and fftwf_ families, picked by precision
+template <typename T>
+struct api;
+
+template <>
+struct api<double> {
+    using complex = fftw_complex;
+    using plan = fftw_plan;
+    static constexpr const char *name = "double";
+    static constexpr auto malloc = fftw_malloc;
+    static constexpr auto free = fftw_free;
+    static constexpr auto plan_dft_1d = fftw_plan_dft_1d;
+    static constexpr auto plan_r2c_1d = fftw_plan_dft_r2c_1d;
+    static constexpr auto plan_c2r_1d = fftw_plan_dft_c2r_1d;
+    static constexpr auto execute = fftw_execute;
+    static constexpr auto destroy_plan = fftw_destroy_plan;
+#ifdef KEYQ_BENCHMARK_THREADS
+    static constexpr auto init_threads = fftw_init_threads;
+    static constexpr auto plan_with_nthreads = fftw_plan_with_nthreads;
+#endif
+};
+
+template <>
+struct api<float> {
+    using complex = fftwf_complex;
+    using plan = fftwf_plan;
+    static constexpr const char *name = "float";
+    static constexpr auto malloc = fftwf_malloc;
+    static constexpr auto free = fftwf_free;
+    static constexpr auto plan_dft_1d = fftwf_plan_dft_1d;
+    static constexpr auto plan_r2c_1d = fftwf_plan_dft_r2c_1d;
+    static constexpr auto plan_c2r_1d = fftwf_plan_dft_c2r_1d;
+    static constexpr auto execute = fftwf_execute;
+    static constexpr auto destroy_plan = fftwf_destroy_plan;
+#ifdef KEYQ_BENCHMARK_THREADS
+    static constexpr auto init_threads = fftwf_init_threads;
+    static constexpr auto plan_with_nthreads = fftwf_plan_with_nthreads;
+#endif
+};
+
+enum class transform { forward, inverse, r2c, c2r };
+
+constexpr const char *transform_names[] = {"forward", "inverse", "r2c", "c2r"};
+
+// The README matrix
+constexpr int sizes[] = {64, 256, 1024, 4096, 16384, 65536, 262144};
+
+// 1, 2, 4, ... up to the hardware's thread count
+std::vector<int> thread_counts() {
+    std::vector<int> counts{1};
+#ifdef KEYQ_BENCHMARK_THREADS
+    const int hardware = static_cast<int>(std::thread::hardware_concurrency());
+    for (int t = 2; t < hardware; t *= 2)
+        counts.push_back(t);
+    if (hardware > 1)
+        counts.push_back(hardware);
+#endif
+    return counts;
+}
+
+// Every run starts from the same input: repeated in-place transforms would otherwise grow
+// to infinity, or decay through denormals where the inverse is normalised, and c2r may
+// overwrite its input. The copy is outside the timed region, so each transform is timed on
+// its own and the clock's overhead (tens of ns) is included in every result. Hardware
+// counters bracket the same region; they follow the calling thread only, so threaded rows
+// miss the pool workers' share.
+template <typename T>
+void run(benchmark::State &state, transform kind, int n, bool in_place,
+         [[maybe_unused]] int threads) {
+    using A = api<T>;
+    const bool real = kind == transform::r2c || kind == transform::c2r;
+
+    // Sizes in T: the complex side holds n values, or n/2+1 for a real transform, and an
+    // in-place real transform pads its real array to the complex side's size
+    const size_t complex_side = 2 * static_cast<size_t>(real ? n / 2 + 1 : n);
+    const size_t in_size = kind == transform::r2c && !in_place ? n : complex_side;
+    const size_t out_size = kind == transform::c2r && !in_place ? n : complex_side;
+
+    T *in = static_cast<T *>(A::malloc(in_size * sizeof(T)));
+    T *out = in_place ? in : static_cast<T *>(A::malloc(out_size * sizeof(T)));
+    std::vector<T> input(in_size);
+    for (size_t i = 0; i < in_size; ++i)
+        input[i] = static_cast<T>(std::sin(0.37 * i) + 0.5 * std::cos(1.3 * i));
+    std::copy(input.begin(), input.end(), in);
+
+#ifdef KEYQ_BENCHMARK_THREADS
+    A::plan_with_nthreads(threads);
+#endif
+    auto *cin = reinterpret_cast<typename A::complex *>(in);
+    auto *cout = reinterpret_cast<typename A::complex *>(out);
+    typename A::plan p = nullptr;
+    switch (kind) {
+        case transform::forward:
+            p = A::plan_dft_1d(n, cin, cout, FFTW_FORWARD, FFTW_MEASURE);
+            break;
+        case transform::inverse:
+            p = A::plan_dft_1d(n, cin, cout, FFTW_BACKWARD, FFTW_MEASURE);
+            break;
+        case transform::r2c:
+            p = A::plan_r2c_1d(n, in, cout, FFTW_MEASURE);
+            break;
+        case transform::c2r:
+            p = A::plan_c2r_1d(n, cin, out, FFTW_MEASURE);
+            break;
+    }
+    // Measuring may have scribbled on the arrays
+    std::copy(input.begin(), input.end(), in);
+
+    if (!p) {
+        state.SkipWithError("planning failed");
+    } else {
+        perf_counters perf;
+        double seconds = 0;
+        for (auto _ : state) {
+            std::copy(input.begin(), input.end(), in);
+            perf.start();
+            const auto start = std::chrono::steady_clock::now();
+            A::execute(p);
+            const auto stop = std::chrono::steady_clock::now();
+            perf.stop();
+            benchmark::DoNotOptimize(out);
+            const double elapsed = std::chrono::duration<double>(stop - start).count();
+            state.SetIterationTime(elapsed);
+            seconds += elapsed;
+        }
+
+        // FFTW's convention: 5 n log2 n flops for a complex transform, half that for real
+        const double per_second = static_cast<double>(state.iterations()) / seconds;
+        const double flops = (real ? 2.5 : 5.0) * n * std::log2(n);
+        state.counters["samples_per_second"] = n * per_second;
+        state.counters["MFLOPS"] = flops * per_second / 1e6;
+        perf.report(state);
+        A::destroy_plan(p);
+    }
+
+    if (!in_place)
+        A::free(out);
+    A::free(in);
+}
+
+// Named library/precision/transform/placement/size/threads:t, e.g.
+// keyq/float/r2c/inplace/4096/threads:1
+template <typename T>
+void register_all() {
+#ifdef KEYQ_BENCHMARK_THREADS
+    api<T>::init_threads();
+#endif
+    for (const int threads : thread_counts())
+        for (const transform kind :
+             {transform::forward, transform::inverse, transform::r2c, transform::c2r})
+            for (const bool in_place : {false, true})
+                for (const int n : sizes) {
+                    const std::string name = std::string(library) + '/' + api<T>::name + '/' +
+                                             transform_names[static_cast<int>(kind)] + '/' +
+                                             (in_place ? "inplace" : "outofplace") + '/' +
+                                             std::to_string(n) +
+                                             "/threads:" + std::to_string(threads);
+                    benchmark::RegisterBenchmark(name.c_str(), run<T>, kind, n, in_place, threads)
+                        ->UseManualTime()
+                        ->Unit(benchmark::kNanosecond);
+                }
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    register_all<float>();
+    register_all<double>();
+
+    benchmark::Initialize(&argc, argv);
+    if (benchmark::ReportUnrecognizedArguments(argc, argv))
+        return 1;
+    benchmark::AddCustomContext("library", library);
+    benchmark::AddCustomContext("perf_counters", perf_counters().status());
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+    return 0;
+}
@@ -0,0 +1,126 @@
+#include "perf_counters.h"
+
+#ifdef __linux__
+
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+#include <string_view>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace {
+
+int open_event(uint32_t type, uint64_t config, int group) {
+    perf_event_attr attr{};
+    attr.size = sizeof(attr);
+    attr.type = type;
+    attr.config = config;
+    attr.disabled = group < 0; // members follow the leader
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.read_format =
+        PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+    return static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, group, 0));
+}
+
+bool is_intel() {
+    std::ifstream cpuinfo("/proc/cpuinfo");
+    for (std::string line; std::getline(cpuinfo, line);)
+        if (line.starts_with("vendor_id"))
+            return line.find("GenuineIntel") != std::string::npos;
+    return false;
+}
+
+} // namespace
+
+perf_counters::perf_counters() {
+    struct wanted {
+        const char *name;
+        uint32_t type;
+        uint64_t config;
+    };
+    std::vector<wanted> wanted_events = {
+        {"cycles", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+        {"instructions", PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+        {"cache_references", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_REFERENCES},
+        {"cache_misses", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES},
+        {"branch_misses", PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+    };
+    // FP_ARITH_INST_RETIRED, every 128-, 256- and 512-bit packed single and double umask
+    if (is_intel())
+        wanted_events.push_back({"fp_vector_ops", PERF_TYPE_RAW, 0xfcc7});
+
+    const char *reason = nullptr;
+    for (const auto &w : wanted_events) {
+        const int group = events_.empty() ? -1 : events_.front().fd;
+        const int fd = open_event(w.type, w.config, group);
+        if (fd >= 0)
+            events_.push_back({w.name, fd});
+        else if (!reason)
+            reason = std::strerror(errno);
+    }
+
+    for (const auto &e : events_) {
+        if (!status_.empty())
+            status_ += ' ';
+        status_ += e.name;
+    }
+    if (events_.empty())
+        status_ = std::string("unavailable: ") + (reason ? reason : "no events");
+}
+
+perf_counters::~perf_counters() {
+    for (const auto &e : events_)
+        close(e.fd);
+}
+
+void perf_counters::start() {
+    if (available())
+        ioctl(events_.front().fd, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+}
+
+void perf_counters::stop() {
+    if (available())
+        ioctl(events_.front().fd, PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+}
+
+void perf_counters::report(benchmark::State &state) const {
+    if (!available())
+        return;
+
+    // nr, time enabled, time running, then one value per event in open order
+    std::vector<uint64_t> values(3 + events_.size());
+    const ssize_t size = static_cast<ssize_t>(values.size() * sizeof(uint64_t));
+    if (read(events_.front().fd, values.data(), size) != size || values[2] == 0)
+        return;
+
+    // Scale up if the group had to share the PMU with other users
+    const double scale = static_cast<double>(values[1]) / static_cast<double>(values[2]);
+    auto count = [&](std::string_view name) {
+        for (size_t i = 0; i < events_.size(); ++i)
+            if (name == events_[i].name)
+                return static_cast<double>(values[3 + i]) * scale;
+        return 0.0;
+    };
+
+    for (const auto &e : events_)
+        state.counters[e.name] =
+            benchmark::Counter(count(e.name), benchmark::Counter::kAvgIterations);
+    if (const double cycles = count("cycles"); cycles > 0)
+        state.counters["IPC"] = count("instructions") / cycles;
+    if (const double references = count("cache_references"); references > 0)
+        state.counters["cache_miss_rate"] = count("cache_misses") / references;
+}
+
+#else
+
+perf_counters::perf_counters() : status_("unavailable: not Linux") {}
+perf_counters::~perf_counters() = default;
+void perf_counters::start() {}
+void perf_counters::stop() {}
+void perf_counters::report(benchmark::State &) const {}
+
+#endif
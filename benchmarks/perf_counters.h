@@ -0,0 +1,42 @@
+#pragma once
+
+#include <benchmark/benchmark.h>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Hardware counters for the calling thread through Linux perf_event_open, as one group so
+// every event covers exactly the same instructions: cycles, instructions, cache references
+// and misses, branch misses and, on Intel, retired packed (SIMD) floating-point
+// instructions. Kernel time is excluded. Events the CPU or the permissions refuse are
+// dropped; with none left, or off Linux, the counters do nothing and status() says why.
+class perf_counters {
+  public:
+    perf_counters();
+    ~perf_counters();
+
+    perf_counters(const perf_counters &) = delete;
+    perf_counters &operator=(const perf_counters &) = delete;
+
+    bool available() const { return !events_.empty(); }
+
+    // The events being counted, or why there are none
+    const std::string &status() const { return status_; }
+
+    // Count between start and stop; counts accumulate across pairs
+    void start();
+    void stop();
+
+    // Per-iteration averages of each event, plus IPC and cache miss rate, as counters
+    void report(benchmark::State &state) const;
+
+  private:
+    struct event {
+        const char *name;
+        int fd;
+    };
+
+    std::vector<event> events_; // the first is the group leader
+    std::string status_;
+};
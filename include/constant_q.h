@@ -0,0 +1,106 @@
+#pragma once
+
+#include <complex>
+#include <cstddef>
+#include <memory>
+#include <span>
+#include <vector>
+
+#include "stft.h"
+
+namespace keyq {
+
+// Streaming constant-Q transform of a real signal: bins spaced bins_per_octave to the octave
+// from low Hz, each with a bandwidth in proportion to its frequency. Every hop the newest
+// fft_size() samples are transformed once and each bin is read off that spectrum through a
+// short precomputed kernel (Brown and Puckette's method), rather than filtering the signal
+// once per bin. Kernels are Hamming-windowed and centred in the frame, so every bin
+// describes the frame's middle, fft_size()/2 samples before its last; entries smaller than
+// threshold times a kernel's peak are dropped. A steady sinusoid of amplitude a on a bin's
+// frequency gives that bin a magnitude of a/2. T is float or double.
+//
+// Kernels depend only on the configuration and are shared by every analyser built with the
+// same one, e.g. one per channel, for as long as any of them is alive.
+template <typename T>
+class constant_q {
+  public:
+    using complex = std::complex<T>;
+
+    struct config {
+        double sample_rate = 44100;
+        double low = 65.40639; // C2, so bin 0 is a C
+        int octaves = 6;
+        int bins_per_octave = 36;
+        int hop = 2048;
+        double threshold = 0.0054;
+    };
+
+    // Throws std::invalid_argument unless sample_rate > 0, 0 < low, octaves, bins_per_octave
+    // and hop >= 1, 0 <= threshold < 1, the top bin's band ends below Nyquist and the
+    // lowest bin's window fits a transform of at most 2^30 points
+    explicit constant_q(const config &c);
+    ~constant_q();
+
+    constant_q(const constant_q &) = delete;
+    constant_q &operator=(const constant_q &) = delete;
+
+    int bins() const;
+    int bins_per_octave() const;
+    int fft_size() const;
+    int hop() const { return frames_.hop(); }
+
+    // Centre frequency of a bin in Hz, and its pitch class: the nearest equal-tempered
+    // semitone to it (A = 440 Hz), 0 for C up to 11 for B
+    double frequency(int bin) const;
+    int pitch_class(int bin) const;
+
+    // Back to silence, as if newly constructed
+    void reset() { frames_.reset(); }
+
+    // Feed n samples, calling on_frame(std::span<const complex>) with bins() values for each
+    // frame they complete. The span is valid until the next push.
+    template <typename F>
+    void push(const T *samples, size_t n, F &&on_frame) {
+        frames_.push(samples, n, [&](std::span<const complex> spectrum) {
+            transform(spectrum, values_);
+            on_frame(std::span<const complex>(values_));
+        });
+    }
+
+    // The bins from fft_size()/2+1 bins of an unwindowed real forward transform of a
+    // frame, as from rdft or fftw_plan_dft_r2c_1d; out has bins() elements. Allocates
+    // nothing.
+    void transform(std::span<const complex> spectrum, std::span<complex> out) const;
+
+    // Magnitudes summed by pitch class into out's 12 values, C first
+    void chroma(std::span<const complex> values, std::span<T> out) const;
+
+  private:
+    struct kernel;
+
+    // The kernel for a configuration, built or found in the cache
+    static std::shared_ptr<const kernel> shared(const config &c);
+
+    std::shared_ptr<const kernel> kernel_;
+    stft<T> frames_;
+    std::vector<complex> values_;
+};
+
+extern template class constant_q<float>;
+extern template class constant_q<double>;
+
+// A key from a chroma vector, by correlation with the 24 rotations of the Krumhansl-Kessler
+// major and minor key profiles. Chroma from many frames, summed, gives a steadier answer
+// than one frame's.
+struct musical_key {
+    int tonic;          // pitch class, 0 for C
+    bool minor;
+    double correlation; // with the winning profile, in [-1, 1]
+};
+
+// scores, when given, receives all 24 correlations: the 12 major keys from C, then the 12
+// minor. Throws std::invalid_argument unless chroma has 12 values and scores 0 or 24.
+musical_key find_key(std::span<const float> chroma, std::span<double> scores = {});
+musical_key find_key(std::span<const double> chroma, std::span<double> scores = {});
+
+} // namespace keyq
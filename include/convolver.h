@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <span>
+#include <vector>
+
+namespace keyq {
+
+// Streaming convolution of a real signal with a long real impulse response, by uniformly
+// partitioned overlap-save. The response is cut into block_size partitions whose spectra
+// are taken once; each block of input is transformed once (real-input, 2 * block_size
+// points) into a frequency-domain delay line, multiplied against every partition, summed
+// and transformed back. Per-block cost is two FFTs and one multiply-add per partition, and
+// output block k depends on input up to the end of block k, so there's no delay beyond the
+// caller's block.
+//
+// With non_uniform, partitions after the first two double in size, each size in a stage
+// of its own, up to max_block_size; the last stage takes the rest of the response. That
+// cuts the total work for very long responses, but a stage's FFTs run in the block that
+// completes it, so the cost per block is no longer constant. T is float or double.
+template <typename T>
+class convolver {
+  public:
+    struct config {
+        int block_size = 256;
+        bool non_uniform = false;
+        int max_block_size = 8192; // largest partition with non_uniform
+    };
+
+    // Throws std::invalid_argument for an empty response or a block size below 1
+    convolver(std::span<const T> impulse_response, const config &c);
+    ~convolver();
+
+    convolver(const convolver &) = delete;
+    convolver &operator=(const convolver &) = delete;
+
+    int block_size() const { return block_size_; }
+
+    // Convolve the next block_size samples; in and out may be the same array
+    void process(const T *in, T *out);
+
+    // Back to silence, keeping the response
+    void reset();
+
+  private:
+    struct stage;
+
+    int block_size_;
+    size_t time_ = 0; // samples processed
+    std::vector<std::unique_ptr<stage>> stages_;
+};
+
+extern template class convolver<float>;
+extern template class convolver<double>;
+
+} // namespace keyq
@@ -0,0 +1,104 @@
+#pragma once
+
+#include <complex>
+#include <coroutine>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <future>
+#include <memory>
+
+#include "stft.h"
+
+namespace keyq {
+
+// Worker threads that analyse frames handed over from any number of threads, for servers
+// that receive frames faster than one caller could transform them. Each job is one frame of
+// real samples to window, transform forward and, optionally, convert to decibels; submit
+// returns at once and the job completes on a worker. A worker takes the oldest job along
+// with others of the same size and window queued behind it, up to max_batch, and runs them
+// through one transform and window; each frame goes through all three stages on the same
+// worker while its samples are in cache, and different batches run on different workers at
+// once. Transforms and windows are built on first use and kept for the executor's lifetime.
+// T is float or double.
+template <typename T>
+class executor {
+  public:
+    using complex = std::complex<T>;
+
+    struct config {
+        int threads = 0; // workers, or 0 for one per hardware thread
+        int max_batch = 32;
+    };
+
+    // The caller's arrays, which must stay valid until the job completes
+    struct job {
+        const T *samples = nullptr; // size values
+        int size = 0;
+        keyq::window window = window::hann;
+        complex *spectrum = nullptr; // size/2+1 unnormalised bins, or null
+        T *decibels = nullptr;       // size/2+1 values of 20 log10(|X| / size), or null
+        T floor = -120;              // decibels for silence
+    };
+
+    // Called on the worker once the job is done, with the error if it failed; mustn't throw
+    using callback = std::function<void(std::exception_ptr)>;
+
+    // Throws std::invalid_argument unless threads >= 0 and max_batch >= 1
+    explicit executor(const config &c = {});
+
+    // Finishes every job already submitted, then joins the workers
+    ~executor();
+
+    executor(const executor &) = delete;
+    executor &operator=(const executor &) = delete;
+
+    int threads() const;
+
+    // Jobs submitted but not yet taken by a worker
+    size_t pending() const;
+
+    // Each throws std::invalid_argument unless samples is given, size >= 2 and there's at
+    // least one output; the job isn't queued then
+    std::future<void> submit(const job &j);
+    void submit(const job &j, callback done);
+
+    // For coroutines: co_await schedule(j) suspends until j is done, resuming on the worker
+    // that ran it, and rethrows its error if it failed
+    class awaiter {
+      public:
+        bool await_ready() const noexcept { return false; }
+
+        void await_suspend(std::coroutine_handle<> waiting) {
+            owner_->submit(job_, [this, waiting](std::exception_ptr e) {
+                error_ = e;
+                waiting.resume();
+            });
+        }
+
+        void await_resume() const {
+            if (error_)
+                std::rethrow_exception(error_);
+        }
+
+      private:
+        friend class executor;
+        awaiter(executor *owner, const job &j) : owner_(owner), job_(j) {}
+
+        executor *owner_;
+        job job_;
+        std::exception_ptr error_;
+    };
+
+    awaiter schedule(const job &j) { return {this, j}; }
+
+  private:
+    struct state;
+
+    std::unique_ptr<state> state_;
+};
+
+extern template class executor<float>;
+extern template class executor<double>;
+
+} // namespace keyq
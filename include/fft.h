@@ -0,0 +1,200 @@
+#pragma once
+
+#include <array>
+#include <bit>
+#include <complex>
+#include <concepts>
+#include <cstddef>
+#include <numbers>
+#include <utility>
+
+namespace keyq {
+
+enum class direction { forward = -1, backward = 1 };
+
+namespace fixed {
+
+// sin and cos for the twiddle tables at compile time (std::sin isn't constexpr until
+// C++26). Taylor series for |x| <= pi/4, where 14 terms are well past double precision.
+constexpr double sin_series(double x) {
+    double term = x;
+    double sum = x;
+    for (int i = 1; i < 14; ++i) {
+        term *= -x * x / ((2 * i) * (2 * i + 1));
+        sum += term;
+    }
+    return sum;
+}
+
+constexpr double cos_series(double x) {
+    double term = 1;
+    double sum = 1;
+    for (int i = 1; i < 14; ++i) {
+        term *= -x * x / ((2 * i - 1) * (2 * i));
+        sum += term;
+    }
+    return sum;
+}
+
+// exp(sign * 2 pi i * k / n): the nearest quarter turn is taken out exactly in integers,
+// leaving an angle within pi/4 for the series
+constexpr std::complex<double> root(size_t k, size_t n, int sign) {
+    const size_t quarters = (4 * (k % n) * 2 + n) / (2 * n);
+    const double rest = static_cast<double>(static_cast<long long>(4 * (k % n)) -
+                                            static_cast<long long>(quarters * n));
+    const double angle = std::numbers::pi / 2 * rest / static_cast<double>(n);
+    const double c = cos_series(angle);
+    const double s = sin_series(angle);
+    double re = c;
+    double im = s;
+    switch (quarters % 4) {
+        case 1:
+            re = -s;
+            im = c;
+            break;
+        case 2:
+            re = -c;
+            im = -s;
+            break;
+        case 3:
+            re = s;
+            im = -c;
+            break;
+    }
+    return {re, sign * im};
+}
+
+// Twiddles for a radix-4 step of size N = 4M: w_N^k, w_N^2k and w_N^3k for each k < M,
+// interleaved, computed in double and then rounded
+template <typename T, size_t N, int Sign>
+inline constexpr auto twiddles = [] {
+    std::array<T, 6 * (N / 4)> w{};
+    for (size_t k = 0; k < N / 4; ++k) {
+        for (size_t t = 1; t <= 3; ++t) {
+            const auto r = root(t * k, N, Sign);
+            w[6 * k + 2 * (t - 1)] = static_cast<T>(r.real());
+            w[6 * k + 2 * (t - 1) + 1] = static_cast<T>(r.imag());
+        }
+    }
+    return w;
+}();
+
+// x * sign * i
+template <int Sign, typename T>
+[[gnu::always_inline]] inline void rotate(T &re, T &im) {
+    const T r = re;
+    re = Sign < 0 ? im : -im;
+    im = Sign < 0 ? -r : r;
+}
+
+// Radix-4 butterfly on x[k + tM], t = 0..3: the outputs of four quarter-size transforms
+// twiddled by w^(tk) and combined with the fourth roots of unity. When the twiddles are
+// known at compile time, 1 and sign * i take no multiplies.
+template <size_t M, int Sign, bool Constant, typename T>
+[[gnu::always_inline]] inline void radix4(T *x, size_t k, const T *w) {
+    T re[4];
+    T im[4];
+    for (size_t t = 0; t < 4; ++t) {
+        re[t] = x[2 * (k + t * M)];
+        im[t] = x[2 * (k + t * M) + 1];
+    }
+    if (!Constant || k != 0) {
+        for (size_t t = 1; t < 4; ++t) {
+            if (Constant && 4 * t * k == 4 * M) {
+                rotate<Sign>(re[t], im[t]);
+                continue;
+            }
+            const T wr = w[2 * (t - 1)];
+            const T wi = w[2 * (t - 1) + 1];
+            const T r = re[t] * wr - im[t] * wi;
+            im[t] = re[t] * wi + im[t] * wr;
+            re[t] = r;
+        }
+    }
+
+    T t0r = re[0] + re[2], t0i = im[0] + im[2];
+    T t1r = re[0] - re[2], t1i = im[0] - im[2];
+    T t2r = re[1] + re[3], t2i = im[1] + im[3];
+    T t3r = re[1] - re[3], t3i = im[1] - im[3];
+    rotate<Sign>(t3r, t3i);
+    x[2 * k] = t0r + t2r;
+    x[2 * k + 1] = t0i + t2i;
+    x[2 * (k + M)] = t1r + t3r;
+    x[2 * (k + M) + 1] = t1i + t3i;
+    x[2 * (k + 2 * M)] = t0r - t2r;
+    x[2 * (k + 2 * M) + 1] = t0i - t2i;
+    x[2 * (k + 3 * M)] = t1r - t3r;
+    x[2 * (k + 3 * M) + 1] = t1i - t3i;
+}
+
+// Decimation in time: the transform of every stride-th complex input is built from the
+// transforms of its four interleaved quarters, written to consecutive quarters of out
+template <size_t N, typename T>
+[[gnu::always_inline]] inline void quarters(const T *in, size_t stride, T *out, auto &&sub) {
+    constexpr size_t M = N / 4;
+    for (size_t t = 0; t < 4; ++t)
+        sub(in + 2 * t * stride, 4 * stride, out + 2 * t * M);
+}
+
+// Straight-line codelet for small N, reading every stride-th complex input and writing N
+// contiguous outputs. Everything inlines into one block with the twiddles as constants.
+template <size_t N, int Sign, typename T>
+[[gnu::always_inline]] inline void codelet(const T *in, size_t stride, T *out) {
+    if constexpr (N == 1) {
+        out[0] = in[0];
+        out[1] = in[1];
+    } else if constexpr (N == 2) {
+        const T ar = in[0], ai = in[1];
+        const T br = in[2 * stride], bi = in[2 * stride + 1];
+        out[0] = ar + br;
+        out[1] = ai + bi;
+        out[2] = ar - br;
+        out[3] = ai - bi;
+    } else {
+        constexpr size_t M = N / 4;
+        quarters<N>(in, stride, out, [](const T *i, size_t s, T *o) { codelet<M, Sign>(i, s, o); });
+        [out]<size_t... K>(std::index_sequence<K...>) {
+            (radix4<M, Sign, true>(out, K, twiddles<T, N, Sign>.data() + 6 * K), ...);
+        }(std::make_index_sequence<M>{});
+    }
+}
+
+// Largest size unrolled completely
+inline constexpr size_t max_codelet = 64;
+
+// Larger sizes recurse on the quarters down to a codelet, then combine them with one loop
+// over the table
+template <size_t N, int Sign, typename T>
+void transform(const T *in, size_t stride, T *out) {
+    if constexpr (N <= max_codelet) {
+        codelet<N, Sign>(in, stride, out);
+    } else {
+        constexpr size_t M = N / 4;
+        quarters<N>(in, stride, out, [](const T *i, size_t s, T *o) { transform<M, Sign>(i, s, o); });
+        const T *w = twiddles<T, N, Sign>.data();
+        for (size_t k = 0; k < M; ++k)
+            radix4<M, Sign, false>(out, k, w + 6 * k);
+    }
+}
+
+} // namespace fixed
+
+// Complex transform whose size and direction are fixed at compile time, for hot paths with
+// a known frame size. Twiddles are constexpr tables and the recursion is resolved by the
+// compiler, so there is no plan, lookup or branch at run time; sizes up to 64 are fully
+// unrolled. Unnormalised, like the FFTW API's engines. N is a power of two.
+template <size_t N, typename T = double, direction D = direction::forward>
+    requires(std::has_single_bit(N) && std::floating_point<T>)
+struct fft {
+    using complex = std::complex<T>;
+
+    static constexpr size_t size = N;
+
+    // in and out must not overlap; to transform in place, copy the input aside first
+    static void execute(const complex *in, complex *out) {
+        fixed::transform<N, static_cast<int>(D)>(reinterpret_cast<const T *>(in), 1,
+                                                 reinterpret_cast<T *>(out));
+    }
+};
+
+} // namespace keyq
@@ -10,6 +10,10 @@ extern "C" {
 typedef double fftw_complex[2];
 typedef struct fftw_plan_s *fftw_plan;
 
+// Single precision: the same API with an fftwf_ prefix, float data and float-native kernels
+typedef float fftwf_complex[2];
+typedef struct fftwf_plan_s *fftwf_plan;
+
 // Direction flags
 #define FFTW_FORWARD (-1)
 #define FFTW_BACKWARD (+1)
@@ -24,6 +28,23 @@ typedef struct fftw_plan_s *fftw_plan;
 #define FFTW_PATIENT (1U << 5)
 #define FFTW_ESTIMATE (1U << 6)
 
+// Real-to-real kinds, as in FFTW: the halfcomplex pair, Hartley, then DCT-I, III, II and IV
+// (REDFT00, 01, 10, 11) and DST-I, III, II and IV (RODFT00, 01, 10, 11)
+typedef enum fftw_r2r_kind_do_not_use_me {
+    FFTW_R2HC = 0,
+    FFTW_HC2R = 1,
+    FFTW_DHT = 2,
+    FFTW_REDFT00 = 3,
+    FFTW_REDFT01 = 4,
+    FFTW_REDFT10 = 5,
+    FFTW_REDFT11 = 6,
+    FFTW_RODFT00 = 7,
+    FFTW_RODFT01 = 8,
+    FFTW_RODFT10 = 9,
+    FFTW_RODFT11 = 10
+} fftw_r2r_kind;
+typedef fftw_r2r_kind fftwf_r2r_kind;
+
 // Core planning functions
 fftw_plan fftw_plan_dft_1d(int n, fftw_complex *in, fftw_complex *out, int sign, unsigned flags);
 
@@ -41,32 +62,187 @@ fftw_plan fftw_plan_dft_r2c_1d(int n, double *in, fftw_complex *out, unsigned fl
 
 fftw_plan fftw_plan_dft_c2r_1d(int n, fftw_complex *in, double *out, unsigned flags);
 
+// Advanced interface: howmany transforms of one shape, element i of transform b at
+// b * dist + stride * (row-major offset of i within the embed extents; null means n).
+// Real transforms are rank 1 only; other ranks return null.
+fftw_plan fftw_plan_many_dft(int rank, const int *n, int howmany, fftw_complex *in,
+                             const int *inembed, int istride, int idist, fftw_complex *out,
+                             const int *onembed, int ostride, int odist, int sign,
+                             unsigned flags);
+
+fftw_plan fftw_plan_many_dft_r2c(int rank, const int *n, int howmany, double *in,
+                                 const int *inembed, int istride, int idist, fftw_complex *out,
+                                 const int *onembed, int ostride, int odist, unsigned flags);
+
+fftw_plan fftw_plan_many_dft_c2r(int rank, const int *n, int howmany, fftw_complex *in,
+                                 const int *inembed, int istride, int idist, double *out,
+                                 const int *onembed, int ostride, int odist, unsigned flags);
+
+// Real-to-real transforms of any rank, one kind per dimension, each O(n log n) through the
+// real or complex FFT. Unlike the c2c and c2r plans here, and as in FFTW, nothing is
+// normalised: REDFT10 then REDFT01, for instance, multiplies by 2n. REDFT00 needs n >= 2;
+// plans it can't make are null.
+fftw_plan fftw_plan_r2r_1d(int n, double *in, double *out, fftw_r2r_kind kind, unsigned flags);
+
+fftw_plan fftw_plan_r2r_2d(int n0, int n1, double *in, double *out, fftw_r2r_kind kind0,
+                           fftw_r2r_kind kind1, unsigned flags);
+
+fftw_plan fftw_plan_r2r_3d(int n0, int n1, int n2, double *in, double *out, fftw_r2r_kind kind0,
+                           fftw_r2r_kind kind1, fftw_r2r_kind kind2, unsigned flags);
+
+fftw_plan fftw_plan_r2r(int rank, const int *n, double *in, double *out,
+                        const fftw_r2r_kind *kind, unsigned flags);
+
+fftw_plan fftw_plan_many_r2r(int rank, const int *n, int howmany, double *in, const int *inembed,
+                             int istride, int idist, double *out, const int *onembed,
+                             int ostride, int odist, const fftw_r2r_kind *kind, unsigned flags);
+
 // Execution functions
+// Plans are read-only once created, so the new-array variants may be called concurrently
+// on one plan from several threads, each with its own in/out arrays
 void fftw_execute(const fftw_plan p);
 void fftw_execute_dft(const fftw_plan p, fftw_complex *in, fftw_complex *out);
 void fftw_execute_dft_r2c(const fftw_plan p, double *in, fftw_complex *out);
 void fftw_execute_dft_c2r(const fftw_plan p, fftw_complex *in, double *out);
+void fftw_execute_r2r(const fftw_plan p, double *in, double *out);
 
-// Memory management
+// Memory management. fftw_malloc returns 64-byte aligned memory for any n; blocks up to
+// 4 MB are recycled through a per-thread cache rather than returned to the system.
 void *fftw_malloc(size_t n);
 void fftw_free(void *p);
 void fftw_destroy_plan(fftw_plan p);
 
-// Wisdom functions
+// Wisdom: what FFTW_MEASURE/PATIENT/EXHAUSTIVE planning found, per size, direction and
+// precision. Export and import round-trip it through a file or a string (release the
+// string with free()); import returns 0 and changes nothing if the text doesn't parse.
 void fftw_forget_wisdom(void);
 int fftw_import_wisdom_from_filename(const char *filename);
 int fftw_export_wisdom_to_filename(const char *filename);
 char *fftw_export_wisdom_to_string(void);
 int fftw_import_wisdom_from_string(const char *input_string);
 
-// Planning time limit
+// Planning time limit in seconds for each size measured; negative means no limit
+#define FFTW_NO_TIMELIMIT (-1.0)
 void fftw_set_timelimit(double t);
 
-// Thread support
+// Thread support: plans made after fftw_plan_with_nthreads(n) split large 1D (four-step),
+// multi-dimensional and batched transforms over a persistent pool of n - 1 workers plus the
+// calling thread. fftw_cleanup_threads joins the pool.
 int fftw_init_threads(void);
 void fftw_plan_with_nthreads(int nthreads);
 void fftw_cleanup_threads(void);
 
+// Single-precision API; planning state (wisdom, time limit, threads) is shared with fftw_
+fftwf_plan fftwf_plan_dft_1d(int n, fftwf_complex *in, fftwf_complex *out, int sign,
+                             unsigned flags);
+
+fftwf_plan fftwf_plan_dft_2d(int n0, int n1, fftwf_complex *in, fftwf_complex *out, int sign,
+                             unsigned flags);
+
+fftwf_plan fftwf_plan_dft_3d(int n0, int n1, int n2, fftwf_complex *in, fftwf_complex *out,
+                             int sign, unsigned flags);
+
+fftwf_plan fftwf_plan_dft(int rank, const int *n, fftwf_complex *in, fftwf_complex *out,
+                          int sign, unsigned flags);
+
+fftwf_plan fftwf_plan_dft_r2c_1d(int n, float *in, fftwf_complex *out, unsigned flags);
+
+fftwf_plan fftwf_plan_dft_c2r_1d(int n, fftwf_complex *in, float *out, unsigned flags);
+
+fftwf_plan fftwf_plan_many_dft(int rank, const int *n, int howmany, fftwf_complex *in,
+                               const int *inembed, int istride, int idist, fftwf_complex *out,
+                               const int *onembed, int ostride, int odist, int sign,
+                               unsigned flags);
+
+fftwf_plan fftwf_plan_many_dft_r2c(int rank, const int *n, int howmany, float *in,
+                                   const int *inembed, int istride, int idist,
+                                   fftwf_complex *out, const int *onembed, int ostride,
+                                   int odist, unsigned flags);
+
+fftwf_plan fftwf_plan_many_dft_c2r(int rank, const int *n, int howmany, fftwf_complex *in,
+                                   const int *inembed, int istride, int idist, float *out,
+                                   const int *onembed, int ostride, int odist, unsigned flags);
+
+fftwf_plan fftwf_plan_r2r_1d(int n, float *in, float *out, fftwf_r2r_kind kind, unsigned flags);
+
+fftwf_plan fftwf_plan_r2r_2d(int n0, int n1, float *in, float *out, fftwf_r2r_kind kind0,
+                             fftwf_r2r_kind kind1, unsigned flags);
+
+fftwf_plan fftwf_plan_r2r_3d(int n0, int n1, int n2, float *in, float *out,
+                             fftwf_r2r_kind kind0, fftwf_r2r_kind kind1, fftwf_r2r_kind kind2,
+                             unsigned flags);
+
+fftwf_plan fftwf_plan_r2r(int rank, const int *n, float *in, float *out,
+                          const fftwf_r2r_kind *kind, unsigned flags);
+
+fftwf_plan fftwf_plan_many_r2r(int rank, const int *n, int howmany, float *in,
+                               const int *inembed, int istride, int idist, float *out,
+                               const int *onembed, int ostride, int odist,
+                               const fftwf_r2r_kind *kind, unsigned flags);
+
+void fftwf_execute(const fftwf_plan p);
+void fftwf_execute_dft(const fftwf_plan p, fftwf_complex *in, fftwf_complex *out);
+void fftwf_execute_dft_r2c(const fftwf_plan p, float *in, fftwf_complex *out);
+void fftwf_execute_dft_c2r(const fftwf_plan p, fftwf_complex *in, float *out);
+void fftwf_execute_r2r(const fftwf_plan p, float *in, float *out);
+
+void *fftwf_malloc(size_t n);
+void fftwf_free(void *p);
+void fftwf_destroy_plan(fftwf_plan p);
+
+void fftwf_forget_wisdom(void);
+int fftwf_import_wisdom_from_filename(const char *filename);
+int fftwf_export_wisdom_to_filename(const char *filename);
+char *fftwf_export_wisdom_to_string(void);
+int fftwf_import_wisdom_from_string(const char *input_string);
+
+void fftwf_set_timelimit(double t);
+
+int fftwf_init_threads(void);
+void fftwf_plan_with_nthreads(int nthreads);
+void fftwf_cleanup_threads(void);
+
+// KEYQ extension, not in FFTW3: per-plan execution counters, collected while stats are on
+// (keyq_enable_stats(1) or KEYQ_STATS=1 in the environment). Trace (keyq_enable_trace(1) or
+// KEYQ_TRACE=1) logs planning, allocation and every execution to stderr. Builds configured
+// with -DKEYQ_INSTRUMENTATION=OFF compile both out and these calls return 0.
+typedef struct keyq_stats {
+    unsigned long long executions;
+    unsigned long long total_ns;
+    unsigned long long min_ns; // 0 before the first execution
+    unsigned long long max_ns;
+    unsigned long long bytes; // input plus output array bytes over all executions
+    const char *algorithm;    // engine per axis, e.g. "radix2 avx2"; lives as long as the plan
+} keyq_stats;
+
+// Switch collection or trace on or off; returns 1 if instrumentation is built in
+int keyq_enable_stats(int on);
+int keyq_enable_trace(int on);
+
+// Fill stats for p; returns 0 and zeroes them if p is null or instrumentation is compiled out
+int keyq_plan_stats(const fftw_plan p, keyq_stats *stats);
+int keyqf_plan_stats(const fftwf_plan p, keyq_stats *stats);
+void keyq_reset_plan_stats(fftw_plan p);
+void keyqf_reset_plan_stats(fftwf_plan p);
+
+// KEYQ extension: back fftw_malloc blocks and plan tables of 2 MB or more with transparent
+// huge pages (also KEYQ_HUGEPAGES=1 in the environment). Returns 1 where supported (Linux),
+// otherwise 0 and nothing changes.
+int keyq_enable_huge_pages(int on);
+
+// KEYQ extension: 1D complex transform of a file too big for memory. in_path holds n
+// interleaved complex values in native byte order; out_path, which must be a different file,
+// is created or resized to match. Both are memory-mapped and streamed through buffers of at
+// most memory bytes in all (0 for 256 MB), with reads and writes overlapping the arithmetic.
+// fftw_execute runs the plan and fftw_destroy_plan unmaps the files; the new-array execute
+// functions ignore it. Like the in-memory plans, backward results are scaled by 1/n. Returns
+// null if a file can't be opened or mapped, or n can't be split into an n1 x n2 grid whose
+// columns of n2 values fit in half of memory.
+fftw_plan keyq_plan_dft_1d_file(long long n, const char *in_path, const char *out_path, int sign,
+                                unsigned flags, size_t memory);
+fftwf_plan keyqf_plan_dft_1d_file(long long n, const char *in_path, const char *out_path,
+                                  int sign, unsigned flags, size_t memory);
+
 #ifdef __cplusplus
 }
 #endif
\ No newline at end of file
@@ -0,0 +1,115 @@
+#pragma once
+
+#include <complex>
+#include <cstddef>
+#include <span>
+#include <vector>
+
+namespace keyq {
+
+// A few selected DFT bins of a real signal, updated every sample in O(1) per bin rather than
+// by transforming a whole frame. Bins are numbered as in an N-point DFT of the newest
+// `window` samples (bin k is k * sample_rate / window Hz) and may be fractional, up to
+// window/2. Each sample costs one complex multiply-add per bin, run across the bins so it
+// vectorises; reading a fractional bin costs one more complex multiply, since the recurrence
+// carries it rotated by e^(j2πk). T is float or double.
+//
+// The recurrence X = r e^(j2πk/N) (X + x(n) - r^N x(n-N)) is stabilised by pulling its pole
+// inside the unit circle by `radius` r < 1: rounding errors then decay instead of
+// accumulating, at the cost of weighting the window by r^j, j samples back. With r = 1 an
+// integer bin would equal the FFT of the window exactly.
+template <typename T>
+class sliding_dft {
+  public:
+    using complex = std::complex<T>;
+
+    struct config {
+        int window = 2048;
+        // Enough below 1 that rounding can't push the pole out; a 2048 window is weighted
+        // down to about 0.98 at its oldest sample
+        double radius = 0.99999;
+    };
+
+    // Throws std::invalid_argument unless window >= 2, 0 < radius <= 1 and every bin is in
+    // [0, window/2]. Nothing is allocated after construction.
+    sliding_dft(std::span<const double> bins, const config &c);
+
+    int window() const { return window_; }
+    size_t size() const { return bins_.size(); }
+
+    // Back to silence, as if newly constructed
+    void reset();
+
+    // Start from a frame: the window's samples, oldest first, and optionally their unwindowed
+    // forward transform, window/2+1 bins as from rdft or fftw_plan_dft_r2c_1d. Integer bins
+    // are taken from the spectrum, so they cost nothing; fractional ones, or all of them
+    // without a spectrum, are summed over the frame. The spectrum is undamped, so it differs
+    // from the damped state by the window weighting; the difference decays at r per sample.
+    // Throws std::invalid_argument if either is the wrong size.
+    void seed(std::span<const T> frame, std::span<const std::complex<T>> spectrum = {});
+
+    // Slide the window along n samples
+    void push(const T *samples, size_t n);
+
+    // Current value of every bin, in construction order; out must have size() elements
+    void values(std::span<complex> out) const;
+    complex value(size_t i) const { return complex(re_[i], im_[i]) * unturn_[i]; }
+
+  private:
+    int window_;
+    std::vector<double> bins_;
+    std::vector<T> history_; // the window, as a ring
+    size_t oldest_ = 0;      // next ring position to be overwritten
+    double radius_;
+
+    // Per bin, split into parts so the update vectorises: the rotation r e^(j2πk/N), the
+    // weight (r e^(j2πk/N))^(N+1) of the sample leaving, and the state
+    std::vector<T> rotate_re_, rotate_im_;
+    std::vector<T> drop_re_, drop_im_;
+    std::vector<T> re_, im_;
+    // e^(-j2πk), taking the state back to the DFT's phase; exactly 1 for integer bins
+    std::vector<complex> unturn_;
+};
+
+// Selected DFT bins of one frame at a time, by the Goertzel recurrence: two real multiply-adds
+// per bin per sample, across the bins so they vectorise, and two complex multiplies per bin
+// at the end. Cheaper than a full transform for a few dozen bins of a long frame, and the
+// bins needn't be integers. Output matches the unnormalised forward DFT of the frame.
+//
+// The recurrence is Reinsch's, whose rounding error stays small near DC and Nyquist where
+// the plain one's grows as 1/sin ω. What's left is largest between N/8 and N/4: on a
+// full-scale noise frame the worst float bin is off by about 5e-5 of its magnitude at
+// N = 8192 and 1e-3 at 65536, against a few parts in 1e6 near DC and Nyquist at either size;
+// double stays below 1e-11. For long float frames where that matters, use goertzel<double>.
+template <typename T>
+class goertzel {
+  public:
+    using complex = std::complex<T>;
+
+    // Throws std::invalid_argument unless frame_size >= 2 and every bin is in
+    // [0, frame_size/2]
+    goertzel(std::span<const double> bins, int frame_size);
+
+    int frame_size() const { return frame_size_; }
+    size_t size() const { return lambda_.size(); }
+
+    // frame has frame_size samples; out has size() elements, one per bin in construction
+    // order. Allocates nothing.
+    void analyse(const T *frame, std::span<complex> out);
+
+  private:
+    int frame_size_;
+    std::vector<T> sign_;   // σ: 1 below a quarter of the frame's bins, -1 above
+    std::vector<T> lambda_; // 2 cos(2πk/N) - 2σ
+    // The final state s, d gives X = weight_s * s + weight_d * d
+    std::vector<complex> weight_s_, weight_d_;
+    // Per-bin recurrence state, reused by each analyse
+    std::vector<T> s_, d_;
+};
+
+extern template class sliding_dft<float>;
+extern template class sliding_dft<double>;
+extern template class goertzel<float>;
+extern template class goertzel<double>;
+
+} // namespace keyq
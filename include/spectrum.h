@@ -0,0 +1,93 @@
+#pragma once
+
+#include <complex>
+#include <cstddef>
+#include <span>
+#include <vector>
+
+// Post-processing for spectra from stft, rdft or the FFTW API, for displays and detectors
+// that run it on every frame. power, decibels, power_db and smooth are single passes compiled
+// for each instruction set and picked at runtime like the butterflies, so they run at the
+// widest vector width the CPU has. Nothing here allocates after construction. Each function
+// works over its input's length; outputs must be at least as long, and may be the input for
+// the real-valued ones.
+namespace keyq::spectrum {
+
+// |X|^2 scale per bin; for frames of N samples, scale 1/N^2 gives squared amplitude
+void power(std::span<const std::complex<float>> bins, std::span<float> out, float scale = 1);
+void power(std::span<const std::complex<double>> bins, std::span<double> out, double scale = 1);
+
+// 10 log10(power) by a short polynomial rather than log10, within 1e-4 dB of exact for float
+// and 1e-6 dB for double. Anything below floor dB, zero and NaN included, comes out as floor,
+// which must be finite.
+void decibels(std::span<const float> power, std::span<float> out, float floor = -120);
+void decibels(std::span<const double> power, std::span<double> out, double floor = -120);
+
+// power then decibels in one pass: 20 log10(|X| / N) is power_db(bins, out, 1 / (N * N))
+void power_db(std::span<const std::complex<float>> bins, std::span<float> out, float scale = 1,
+              float floor = -120);
+void power_db(std::span<const std::complex<double>> bins, std::span<double> out,
+              double scale = 1, double floor = -120);
+
+// Each frame, state moves the fraction attack of the way to in where in is higher and
+// release where it's lower: 1 follows at once, smaller values follow more slowly
+void smooth(std::span<const float> in, std::span<float> state, float attack, float release);
+void smooth(std::span<const double> in, std::span<double> state, double attack,
+            double release);
+
+template <typename T>
+struct peak {
+    double bin; // fractional
+    T value;
+};
+
+// Interior local maxima above threshold, strongest first, as many as fit in out; returns how
+// many were written. Each is refined by the parabola through it and its neighbours, which on
+// a dB spectrum places a windowed sinusoid to within a few hundredths of a bin.
+size_t find_peaks(std::span<const float> spectrum, float threshold, std::span<peak<float>> out);
+size_t find_peaks(std::span<const double> spectrum, double threshold,
+                  std::span<peak<double>> out);
+
+// Maps the fft_size/2+1 bins of a real transform onto bands spaced logarithmically between
+// low and high Hz, e.g. the bars of an analyser. Bands spanning at least one bin take the
+// max or mean of their bins; narrower ones, at the bottom, interpolate between the two bins
+// either side of their centre. Bin ranges and weights are worked out once, here.
+template <typename T>
+class log_bins {
+  public:
+    enum class reduce { max, mean };
+
+    struct config {
+        int fft_size = 2048;
+        double sample_rate = 44100;
+        int bands = 100;
+        double low = 20;
+        double high = 20000; // clamped to Nyquist
+        reduce how = reduce::max;
+    };
+
+    // Throws std::invalid_argument unless fft_size >= 2, bands >= 1 and 0 < low < high
+    explicit log_bins(const config &c);
+
+    int bands() const { return static_cast<int>(first_.size()); }
+    size_t bins() const { return bins_; }
+
+    // Geometric centre of a band, in Hz
+    double centre(int band) const { return centre_[band]; }
+
+    // spectrum has bins() values, in any units (power, magnitude or dB); out has bands()
+    void map(std::span<const T> spectrum, std::span<T> out) const;
+
+  private:
+    reduce how_;
+    size_t bins_;
+    std::vector<int> first_; // first bin of each band
+    std::vector<int> count_; // bins in the band, or 0 to interpolate
+    std::vector<T> weight_;  // when interpolating, the share of bin first + 1
+    std::vector<double> centre_;
+};
+
+extern template class log_bins<float>;
+extern template class log_bins<double>;
+
+} // namespace keyq::spectrum
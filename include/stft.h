@@ -0,0 +1,82 @@
+#pragma once
+
+#include <complex>
+#include <cstddef>
+#include <memory>
+#include <span>
+#include <vector>
+
+namespace keyq {
+
+template <typename T>
+class rdft;
+
+enum class window { rectangular, hann, hamming, blackman };
+
+// Streaming short-time Fourier transform of a real signal. Every hop samples the newest
+// frame_size samples are windowed and transformed to frame_size/2+1 unnormalised bins, so
+// each frame is delivered as its last sample arrives: a fixed latency of frame_size samples
+// from the frame's start. The history starts as silence, so the first frame comes after hop
+// samples. Samples are written twice into a mirrored ring, which keeps every frame
+// contiguous; nothing is allocated after construction. T is float or double.
+template <typename T>
+class stft {
+  public:
+    using complex = std::complex<T>;
+
+    struct config {
+        int frame_size = 2048;
+        int hop = 512;
+        keyq::window window = window::hann; // periodic, so overlapped frames sum evenly
+    };
+
+    // Throws std::invalid_argument unless frame_size >= 2 and hop >= 1
+    explicit stft(const config &c);
+    ~stft();
+
+    stft(const stft &) = delete;
+    stft &operator=(const stft &) = delete;
+
+    int frame_size() const { return frame_size_; }
+    int hop() const { return hop_; }
+    int bins() const { return frame_size_ / 2 + 1; }
+
+    // Back to silence, as if newly constructed
+    void reset();
+
+    // Feed n samples, calling on_frame(std::span<const complex>) for each frame they
+    // complete. The span is valid until the next push.
+    template <typename F>
+    void push(const T *samples, size_t n, F &&on_frame) {
+        while (n > 0) {
+            const size_t used = fill(samples, n);
+            samples += used;
+            n -= used;
+            if (pending_ == static_cast<size_t>(hop_))
+                on_frame(std::span<const complex>(analyse()));
+        }
+    }
+
+  private:
+    // Copy samples up to the next frame boundary; returns how many were taken
+    size_t fill(const T *samples, size_t n);
+
+    // Window and transform the newest frame into spectrum_
+    const std::vector<complex> &analyse();
+
+    int frame_size_;
+    int hop_;
+    std::vector<T> window_;
+    std::vector<T> ring_;      // 2 * frame_size, each sample at i and i + frame_size
+    size_t write_ = 0;         // next ring position, in [0, frame_size)
+    size_t pending_ = 0;       // samples since the last frame
+    std::vector<T> frame_;     // windowed input to the transform
+    std::vector<complex> spectrum_;
+    std::vector<complex> scratch_;
+    std::unique_ptr<const rdft<T>> engine_;
+};
+
+extern template class stft<float>;
+extern template class stft<double>;
+
+} // namespace keyq
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+namespace keyq {
+
+// Wait-free single-producer, single-consumer hand-off of the latest value, such as an
+// analysis frame going from the audio thread to the UI. Three slots: the producer fills its
+// own, then swaps it with the shared one; the consumer swaps the shared one for its own
+// when it's newer. Each side is one atomic exchange, so neither ever waits and the consumer
+// always sees a complete value, the newest published; intermediate ones may be skipped.
+// Slots are allocated up front: give T its final size in the constructor.
+template <typename T>
+class triple_buffer {
+  public:
+    triple_buffer() = default;
+    explicit triple_buffer(const T &initial) : slots_{{initial}, {initial}, {initial}} {}
+
+    triple_buffer(const triple_buffer &) = delete;
+    triple_buffer &operator=(const triple_buffer &) = delete;
+
+    // Producer: the slot to fill, which keeps whatever it last held
+    T &write_buffer() { return slots_[back_].value; }
+
+    // Producer: hand the filled slot to the consumer
+    void publish() {
+        back_ = shared_.exchange(static_cast<uint8_t>(back_ | fresh), std::memory_order_acq_rel) &
+                index;
+    }
+
+    void publish(const T &value) {
+        write_buffer() = value;
+        publish();
+    }
+
+    // Consumer: the newest published value, or the same one as last time if there's nothing
+    // new. Valid until the next call.
+    const T &read() {
+        if (shared_.load(std::memory_order_relaxed) & fresh)
+            front_ = shared_.exchange(front_, std::memory_order_acq_rel) & index;
+        return slots_[front_].value;
+    }
+
+  private:
+    static constexpr uint8_t index = 0x3;
+    static constexpr uint8_t fresh = 0x4; // the shared slot hasn't been read yet
+
+    // A cache line each, so the two sides don't false-share
+    struct alignas(64) slot {
+        T value;
+    };
+
+    slot slots_[3];
+    alignas(64) std::atomic<uint8_t> shared_{1};
+    alignas(64) uint8_t back_ = 0;  // producer's slot
+    alignas(64) uint8_t front_ = 2; // consumer's slot
+};
+
+} // namespace keyq
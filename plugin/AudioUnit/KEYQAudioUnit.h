@@ -2,9 +2,13 @@
 
 #include <AudioToolbox/AudioToolbox.h>
 #include <AudioUnit/AudioUnit.h>
+#include <complex>
+#include <span>
 #include <vector>
-#include <mutex>
 #include "../../include/keyq.h"
+#include "../../include/spectrum.h"
+#include "../../include/stft.h"
+#include "../../include/triple_buffer.h"
 
 // Audio Unit component description
 #define KEYQ_COMP_TYPE 'aufx'  // Effect type
@@ -45,23 +49,20 @@ public:
                         const void* inData,
                         UInt32 inDataSize);
 
-    // Get spectrum data for UI
+    // Get spectrum data for UI; call from one thread at a time
     void GetSpectrumData(float* magnitudes, int binCount);
 
 private:
-    // FFT setup
+    // Streaming analysis: 75% overlapped Hann frames of the first channel
     static constexpr int kFFTSize = 2048;
-    fftw_plan fftPlan;
-    fftw_complex* fftInput;
-    fftw_complex* fftOutput;
+    static constexpr int kHopSize = kFFTSize / 4;
+    keyq::stft<float> analyser;
 
-    // Ring buffer for overlapping windows
-    std::vector<float> ringBuffer;
-    int writeIndex;
-
-    // Spectrum data for visualisation
+    // Spectrum data for visualisation: smoothed on the render thread, then published to
+    // the UI without locking, so a slow reader can never stall rendering
+    std::vector<float> frameDecibels;
     std::vector<float> spectrumMagnitudes;
-    std::mutex spectrumMutex;
+    keyq::triple_buffer<std::vector<float>> publishedSpectrum;
 
     // Audio format
     Float64 sampleRate;
@@ -71,11 +72,6 @@ private:
     double testTonePhase;
     bool silenceDetected;
 
-    // Window function
-    std::vector<float> windowFunction;
-    void CreateHannWindow();
-
     // Processing
-    void ProcessFFT();
-    void UpdateSpectrum();
+    void UpdateSpectrum(std::span<const std::complex<float>> bins);
 };
\ No newline at end of file
@@ -6,44 +6,18 @@
 
 // Constructor
 KEYQAudioUnit::KEYQAudioUnit()
-    : fftPlan(nullptr),
-      fftInput(nullptr),
-      fftOutput(nullptr),
-      writeIndex(0),
+    : analyser({kFFTSize, kHopSize, keyq::window::hann}),
+      frameDecibels(kFFTSize / 2, 0.0f),
+      spectrumMagnitudes(kFFTSize / 2, 0.0f),
+      publishedSpectrum(spectrumMagnitudes),
       sampleRate(44100.0),
       maxFramesPerSlice(512),
       testTonePhase(0.0),
       silenceDetected(false) {
-
-    // Allocate FFT buffers
-    fftInput = (fftw_complex*)fftw_malloc(sizeof(fftw_complex) * kFFTSize);
-    fftOutput = (fftw_complex*)fftw_malloc(sizeof(fftw_complex) * kFFTSize);
-
-    // Create FFT plan
-    fftPlan = fftw_plan_dft_1d(kFFTSize, fftInput, fftOutput, FFTW_FORWARD, FFTW_ESTIMATE);
-
-    // Initialize ring buffer
-    ringBuffer.resize(kFFTSize * 2, 0.0f);
-
-    // Initialize spectrum
-    spectrumMagnitudes.resize(kFFTSize / 2, 0.0f);
-
-    // Create window function
-    CreateHannWindow();
 }
 
 // Destructor
-KEYQAudioUnit::~KEYQAudioUnit() {
-    if (fftPlan) {
-        fftw_destroy_plan(fftPlan);
-    }
-    if (fftInput) {
-        fftw_free(fftInput);
-    }
-    if (fftOutput) {
-        fftw_free(fftOutput);
-    }
-}
+KEYQAudioUnit::~KEYQAudioUnit() = default;
 
 // Initialize
 OSStatus KEYQAudioUnit::Initialize() {
@@ -62,25 +36,16 @@ OSStatus KEYQAudioUnit::Uninitialize() {
 OSStatus KEYQAudioUnit::Reset() {
     NSLog(@"KEYQ Audio Unit: Reset");
 
-    // Clear ring buffer
-    std::fill(ringBuffer.begin(), ringBuffer.end(), 0.0f);
-    writeIndex = 0;
+    // Clear analysis history
+    analyser.reset();
 
-    // Clear spectrum
-    std::lock_guard<std::mutex> lock(spectrumMutex);
+    // Clear spectrum; hosts don't reset while rendering, so this is the only producer
     std::fill(spectrumMagnitudes.begin(), spectrumMagnitudes.end(), 0.0f);
+    publishedSpectrum.publish(spectrumMagnitudes);
 
     return noErr;
 }
 
-// Create Hann window
-void KEYQAudioUnit::CreateHannWindow() {
-    windowFunction.resize(kFFTSize);
-    for (int i = 0; i < kFFTSize; ++i) {
-        windowFunction[i] = 0.5f * (1.0f - cosf(2.0f * M_PI * i / (kFFTSize - 1)));
-    }
-}
-
 // Process audio
 OSStatus KEYQAudioUnit::ProcessBufferLists(AudioUnitRenderActionFlags* ioActionFlags,
                                              const AudioTimeStamp* inTimeStamp,
@@ -110,62 +75,38 @@ OSStatus KEYQAudioUnit::ProcessBufferLists(AudioUnitRenderActionFlags* ioActionF
 
     silenceDetected = !hasSignal;
 
-    // MINIMAL PASS-THROUGH - NO PROCESSING TO AVOID CORRUPTION
-    // Audio passes through completely unchanged
-    // (All FFT and analysis temporarily disabled for safety)
+    // Audio passes through unchanged; the analyser only reads the first channel and
+    // allocates nothing, so it is safe on the render thread
+    if (ioData->mNumberBuffers > 0) {
+        const Float32* samples = (const Float32*)ioData->mBuffers[0].mData;
+        analyser.push(samples, inNumberFrames, [this](std::span<const std::complex<float>> bins) {
+            UpdateSpectrum(bins);
+        });
+    }
 
     // Log audio presence occasionally (safe logging only)
     static int presenceCount = 0;
     if (++presenceCount % 5000 == 1) {
-        NSLog(@"KEYQ: Pure pass-through active, max level: %.3f", maxLevel);
+        NSLog(@"KEYQ: Pass-through with analysis, max level: %.3f", maxLevel);
     }
 
     return noErr;
 }
 
-// Perform FFT analysis
-void KEYQAudioUnit::ProcessFFT() {
-    // Copy windowed samples to FFT input
-    int readIndex = (writeIndex - kFFTSize + ringBuffer.size()) % ringBuffer.size();
-
-    for (int i = 0; i < kFFTSize; ++i) {
-        float sample = ringBuffer[(readIndex + i) % ringBuffer.size()];
-        fftInput[i][0] = sample * windowFunction[i];  // Real part with window
-        fftInput[i][1] = 0.0;                         // Imaginary part
-    }
-
-    // Execute FFT
-    fftw_execute(fftPlan);
-
-    // Update spectrum
-    UpdateSpectrum();
-}
-
-// Update spectrum magnitudes
-void KEYQAudioUnit::UpdateSpectrum() {
-    std::lock_guard<std::mutex> lock(spectrumMutex);
-
-    // Calculate magnitudes for positive frequencies only
-    float maxMagnitude = -100.0f;
-    int peakBin = 0;
-
-    for (int i = 0; i < kFFTSize / 2; ++i) {
-        float real = fftOutput[i][0];
-        float imag = fftOutput[i][1];
-        float magnitude = sqrtf(real * real + imag * imag) / kFFTSize;
+// Update spectrum magnitudes from one analysis frame
+void KEYQAudioUnit::UpdateSpectrum(std::span<const std::complex<float>> bins) {
+    // 20 log10(|X| / N) for positive frequencies only, smoothed with the previous frames
+    constexpr float scale = 1.0f / (float(kFFTSize) * kFFTSize);
+    keyq::spectrum::power_db(bins.first(kFFTSize / 2), frameDecibels, scale, -200.0f);
+    keyq::spectrum::smooth(frameDecibels, spectrumMagnitudes, 0.3f, 0.3f);
 
-        // Convert to dB with smoothing
-        float db = 20.0f * log10f(magnitude + 1e-10f);
+    // Track peak for debugging
+    const auto peak = std::max_element(spectrumMagnitudes.begin(), spectrumMagnitudes.end());
+    const float maxMagnitude = *peak;
+    const int peakBin = (int)(peak - spectrumMagnitudes.begin());
 
-        // Smooth with previous value
-        spectrumMagnitudes[i] = spectrumMagnitudes[i] * 0.7f + db * 0.3f;
-
-        // Track peak for debugging
-        if (spectrumMagnitudes[i] > maxMagnitude) {
-            maxMagnitude = spectrumMagnitudes[i];
-            peakBin = i;
-        }
-    }
+    // Hand the frame to the UI; the slot is already the right size, so this only copies
+    publishedSpectrum.publish(spectrumMagnitudes);
 
     // Log peak frequency (every 100 FFTs to avoid spam)
     static int fftCount = 0;
@@ -178,10 +119,10 @@ void KEYQAudioUnit::UpdateSpectrum() {
 
 // Get spectrum data for UI
 void KEYQAudioUnit::GetSpectrumData(float* magnitudes, int binCount) {
-    std::lock_guard<std::mutex> lock(spectrumMutex);
+    const std::vector<float>& latest = publishedSpectrum.read();
 
-    int copyCount = std::min(binCount, (int)spectrumMagnitudes.size());
-    std::copy(spectrumMagnitudes.begin(), spectrumMagnitudes.begin() + copyCount, magnitudes);
+    int copyCount = std::min(binCount, (int)latest.size());
+    std::copy(latest.begin(), latest.begin() + copyCount, magnitudes);
 }
 
 // Get property info
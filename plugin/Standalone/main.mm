@@ -1,40 +1,60 @@
 #import <Cocoa/Cocoa.h>
 #import <AVFoundation/AVFoundation.h>
 #include "../../include/keyq.h"
+#include "../../include/spectrum.h"
+#include "../../include/stft.h"
+#include "../../include/triple_buffer.h"
+#include <complex>
+#include <memory>
+#include <span>
 #include <vector>
 #include <cmath>
 
 @interface SpectrumView : NSView
-@property (nonatomic) std::vector<float> magnitudes;
-@property (nonatomic) fftw_plan fftPlan;
-@property (nonatomic) fftw_complex* fftInput;
-@property (nonatomic) fftw_complex* fftOutput;
+- (void)setSampleRate:(double)sampleRate;
 @end
 
-@implementation SpectrumView
+@implementation SpectrumView {
+    // 512-point Hann frames every 256 samples, whatever size the tap delivers
+    std::unique_ptr<keyq::stft<float>> _analyser;
+
+    // Smoothed on the audio tap's thread, then published to drawRect without locking. The
+    // buffer lives on the heap because Objective-C ivars don't honour its cache-line alignment.
+    std::vector<float> _frame;
+    std::vector<float> _smoothed;
+    std::unique_ptr<keyq::triple_buffer<std::vector<float>>> _published;
+
+    // Bins to logarithmically spaced bars, rebuilt when the sample rate is known
+    std::unique_ptr<keyq::spectrum::log_bins<float>> _bars;
+    std::vector<float> _barLevels;
+}
 
 - (instancetype)initWithFrame:(NSRect)frameRect {
     self = [super initWithFrame:frameRect];
     if (self) {
-        _magnitudes.resize(256, 0.0f);
-
-        // Setup FFT
-        _fftInput = (fftw_complex*)fftw_malloc(sizeof(fftw_complex) * 512);
-        _fftOutput = (fftw_complex*)fftw_malloc(sizeof(fftw_complex) * 512);
-        _fftPlan = fftw_plan_dft_1d(512, _fftInput, _fftOutput, FFTW_FORWARD, FFTW_ESTIMATE);
+        _analyser = std::make_unique<keyq::stft<float>>(
+            keyq::stft<float>::config{512, 256, keyq::window::hann});
+        _frame.resize(_analyser->bins(), 0.0f);
+        _smoothed.resize(_analyser->bins(), -80.0f);
+        _published = std::make_unique<keyq::triple_buffer<std::vector<float>>>(_smoothed);
+        _barLevels.resize(100, -80.0f);
+        [self setSampleRate:44100.0];
     }
     return self;
 }
 
-- (void)dealloc {
-    if (_fftPlan) fftw_destroy_plan(_fftPlan);
-    if (_fftInput) fftw_free(_fftInput);
-    if (_fftOutput) fftw_free(_fftOutput);
+- (void)setSampleRate:(double)sampleRate {
+    _bars = std::make_unique<keyq::spectrum::log_bins<float>>(
+        keyq::spectrum::log_bins<float>::config{512, sampleRate, (int)_barLevels.size(), 40.0,
+                                                20000.0});
 }
 
 - (void)drawRect:(NSRect)dirtyRect {
     [super drawRect:dirtyRect];
 
+    // Newest spectrum the audio thread has published
+    const std::vector<float>& magnitudes = _published->read();
+
     // Black background
     [[NSColor blackColor] setFill];
     NSRectFill(dirtyRect);
@@ -48,8 +68,8 @@
 
     // Check if magnitudes are all very low (no audio)
     float maxMag = -100.0f;
-    for (size_t i = 0; i < _magnitudes.size(); ++i) {
-        if (_magnitudes[i] > maxMag) maxMag = _magnitudes[i];
+    for (size_t i = 0; i < magnitudes.size(); ++i) {
+        if (magnitudes[i] > maxMag) maxMag = magnitudes[i];
     }
 
     // Draw status indicator
@@ -70,35 +90,22 @@
     [[NSColor greenColor] setFill];
 
     // Draw with logarithmic spacing - more space for lower frequencies
-    int totalBars = 100; // Number of bars to display
+    int totalBars = (int)_barLevels.size();
     float pixelWidth = bounds.size.width / totalBars;
 
     // Safety check
-    if (_magnitudes.empty() || bounds.size.width <= 0 || bounds.size.height <= 0) {
+    if (magnitudes.empty() || bounds.size.width <= 0 || bounds.size.height <= 0) {
         NSLog(@"Warning: Invalid draw state - magnitudes=%zu, bounds=(%f,%f)",
-              _magnitudes.size(), bounds.size.width, bounds.size.height);
+              magnitudes.size(), bounds.size.width, bounds.size.height);
         return;
     }
 
-    for (int barIndex = 0; barIndex < totalBars; ++barIndex) {
-        // Map bar position to FFT bin logarithmically
-        // Use a simple power curve to map bar index to bin index
-        float normalized = (float)barIndex / totalBars;
-        float curved = normalized * normalized * normalized; // Cubic curve for log-like behavior
-        int binIndex = (int)(curved * (_magnitudes.size() - 1));
-
-        // Safety bounds check
-        if (binIndex < 0 || binIndex >= _magnitudes.size()) {
-            NSLog(@"Bin index out of range: %d (max %zu)", binIndex, _magnitudes.size());
-            continue;
-        }
+    // Loudest bin in each bar's frequency range, from a map worked out once
+    _bars->map(magnitudes, _barLevels);
 
+    for (int barIndex = 0; barIndex < totalBars; ++barIndex) {
         // Better dynamic range: map -60dB to +20dB for more visibility
-        float magnitude = _magnitudes[binIndex];
-        if (!isfinite(magnitude)) {
-            NSLog(@"Invalid magnitude at bin %d: %f", binIndex, magnitude);
-            continue;
-        }
+        float magnitude = _barLevels[barIndex];
 
         float normalizedHeight = (magnitude + 60.0f) / 80.0f;  // More sensitive range
         normalizedHeight = fmaxf(0.0f, fminf(1.0f, normalizedHeight));
@@ -111,30 +118,16 @@
 }
 
 - (void)updateWithAudioBuffer:(float*)buffer length:(int)length {
-    // Copy to FFT input
-    for (int i = 0; i < std::min(length, 512); ++i) {
-        _fftInput[i][0] = buffer[i];
-        _fftInput[i][1] = 0.0;
-    }
-
-    // Execute FFT
-    fftw_execute(_fftPlan);
-
-    // Calculate magnitudes
-    for (size_t i = 0; i < _magnitudes.size(); ++i) {
-        float real = _fftOutput[i][0];
-        float imag = _fftOutput[i][1];
-        float magnitude = sqrtf(real * real + imag * imag);
-        float db = 20.0f * log10f(magnitude + 1e-10f);
-
-        // Check for NaN or Inf
-        if (!isfinite(db)) {
-            NSLog(@"Invalid dB value at bin %zu: magnitude=%f, db=%f", i, magnitude, db);
-            db = -80.0f; // Default to silence
-        }
+    _analyser->push(buffer, length, [self](std::span<const std::complex<float>> bins) {
+        [self updateWithSpectrum:bins];
+    });
+}
 
-        _magnitudes[i] = _magnitudes[i] * 0.8f + db * 0.2f; // Smooth
-    }
+- (void)updateWithSpectrum:(std::span<const std::complex<float>>)bins {
+    // 20 log10 |X| per bin, then smoothed; NaN and silence come out at the -80 dB floor
+    keyq::spectrum::power_db(bins, _frame, 1.0f, -80.0f);
+    keyq::spectrum::smooth(_frame, _smoothed, 0.2f, 0.2f);
+    _published->publish(_smoothed);
 
     dispatch_async(dispatch_get_main_queue(), ^{
         [self setNeedsDisplay:YES];
@@ -165,6 +158,7 @@
 
     AVAudioInputNode* input = [_engine inputNode];
     AVAudioFormat* format = [input inputFormatForBus:0];
+    [_spectrumView setSampleRate:format.sampleRate];
 
     NSLog(@"Input format: %@", format);
     NSLog(@"Sample rate: %.0f Hz", format.sampleRate);
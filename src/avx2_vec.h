@@ -0,0 +1,60 @@
+#pragma once
+
+#include <immintrin.h>
+
+// AVX2 + FMA vector types, shared by the AVX2 kernels and as the narrow fallback of the
+// AVX-512 ones. Only include from files compiled with -mavx2 -mfma.
+
+namespace keyq::simd {
+namespace {
+
+template <typename T>
+struct avx2_vec;
+
+// Two complex doubles per register
+template <>
+struct avx2_vec<double> {
+    using value_type = double;
+    static constexpr int lanes = 2;
+    using reg = __m256d;
+
+    static reg load(const double *p) { return _mm256_loadu_pd(p); }
+    static void store(double *p, reg a) { _mm256_storeu_pd(p, a); }
+    static reg add(reg a, reg b) { return _mm256_add_pd(a, b); }
+    static reg sub(reg a, reg b) { return _mm256_sub_pd(a, b); }
+    static reg cmul(reg a, reg w) {
+        const reg wr = _mm256_movedup_pd(w);
+        const reg wi = _mm256_permute_pd(w, 0xF);
+        return _mm256_fmaddsub_pd(a, wr, _mm256_mul_pd(_mm256_permute_pd(a, 0x5), wi));
+    }
+    static reg rotation(int sign) {
+        return _mm256_set_pd(1.0 * sign, -1.0 * sign, 1.0 * sign, -1.0 * sign);
+    }
+    static reg rot(reg a, reg r) { return _mm256_mul_pd(_mm256_permute_pd(a, 0x5), r); }
+};
+
+// Four complex floats per register
+template <>
+struct avx2_vec<float> {
+    using value_type = float;
+    static constexpr int lanes = 4;
+    using reg = __m256;
+
+    static reg load(const float *p) { return _mm256_loadu_ps(p); }
+    static void store(float *p, reg a) { _mm256_storeu_ps(p, a); }
+    static reg add(reg a, reg b) { return _mm256_add_ps(a, b); }
+    static reg sub(reg a, reg b) { return _mm256_sub_ps(a, b); }
+    static reg cmul(reg a, reg w) {
+        const reg wr = _mm256_moveldup_ps(w);
+        const reg wi = _mm256_movehdup_ps(w);
+        return _mm256_fmaddsub_ps(a, wr, _mm256_mul_ps(_mm256_permute_ps(a, 0xB1), wi));
+    }
+    static reg rotation(int sign) {
+        const float s = sign;
+        return _mm256_set_ps(s, -s, s, -s, s, -s, s, -s);
+    }
+    static reg rot(reg a, reg r) { return _mm256_mul_ps(_mm256_permute_ps(a, 0xB1), r); }
+};
+
+} // namespace
+} // namespace keyq::simd
@@ -0,0 +1,106 @@
+#pragma once
+
+#include "kernels.h"
+#include "spectrum_loops.h"
+
+// Butterfly loops shared by every instruction set. Each kernels_*.cxx file includes this
+// with its own vector type; the unnamed namespace keeps every instantiation local to the
+// file that compiled it, so code built with wider target flags can't leak into the others.
+//
+// A vector type V provides: value_type, lanes, reg, load, store, add, sub, cmul (complex
+// multiply), rotation(sign) and rot(a, rotation) (multiply by sign * i). It may also name a
+// narrower type V::narrow for stages whose half-length h is less than its lane count;
+// otherwise those stages run scalar.
+
+namespace keyq::simd {
+namespace {
+
+template <typename T>
+struct scalar_vec {
+    using value_type = T;
+    static constexpr int lanes = 1;
+    struct reg {
+        T re, im;
+    };
+
+    static reg load(const T *p) { return {p[0], p[1]}; }
+    static void store(T *p, reg a) {
+        p[0] = a.re;
+        p[1] = a.im;
+    }
+    static reg add(reg a, reg b) { return {a.re + b.re, a.im + b.im}; }
+    static reg sub(reg a, reg b) { return {a.re - b.re, a.im - b.im}; }
+    static reg cmul(reg a, reg w) {
+        return {a.re * w.re - a.im * w.im, a.re * w.im + a.im * w.re};
+    }
+    static reg rotation(int sign) { return {T(-sign), T(sign)}; }
+    static reg rot(reg a, reg r) { return {a.im * r.re, a.re * r.im}; }
+};
+
+template <typename V>
+struct narrower {
+    using type = scalar_vec<typename V::value_type>;
+};
+
+template <typename V>
+    requires requires { typename V::narrow; }
+struct narrower<V> {
+    using type = typename V::narrow;
+};
+
+template <typename V, typename T = typename V::value_type>
+void radix2_stage(T *data, size_t n, size_t h, const T *w) {
+    if (h % V::lanes != 0)
+        return radix2_stage<typename narrower<V>::type>(data, n, h, w);
+
+    for (size_t i = 0; i < n; i += 2 * h) {
+        T *x = data + 2 * i;
+        for (size_t j = 0; j < h; j += V::lanes) {
+            const auto u = V::load(x + 2 * j);
+            const auto v = V::cmul(V::load(x + 2 * (j + h)), V::load(w + 2 * j));
+            V::store(x + 2 * j, V::add(u, v));
+            V::store(x + 2 * (j + h), V::sub(u, v));
+        }
+    }
+}
+
+// Stage 2h combines (a, b) and (c, d) with w = w_2h^j; stage 4h then combines (a, c) with
+// W = w_4h^j and (b, d) with w_4h^(j+h) = W * sign * i
+template <typename V, typename T = typename V::value_type>
+void radix4_stage(T *data, size_t n, size_t h, const T *w2, const T *w4, int sign) {
+    if (h % V::lanes != 0)
+        return radix4_stage<typename narrower<V>::type>(data, n, h, w2, w4, sign);
+
+    const auto r = V::rotation(sign);
+    for (size_t i = 0; i < n; i += 4 * h) {
+        T *x = data + 2 * i;
+        for (size_t j = 0; j < h; j += V::lanes) {
+            const auto w = V::load(w2 + 2 * j);
+            const auto W = V::load(w4 + 2 * j);
+
+            const auto a = V::load(x + 2 * j);
+            const auto b = V::cmul(V::load(x + 2 * (j + h)), w);
+            const auto c = V::load(x + 2 * (j + 2 * h));
+            const auto d = V::cmul(V::load(x + 2 * (j + 3 * h)), w);
+
+            const auto a1 = V::add(a, b);
+            const auto b1 = V::sub(a, b);
+            const auto c1 = V::cmul(V::add(c, d), W);
+            const auto d1 = V::rot(V::cmul(V::sub(c, d), W), r);
+
+            V::store(x + 2 * j, V::add(a1, c1));
+            V::store(x + 2 * (j + h), V::add(b1, d1));
+            V::store(x + 2 * (j + 2 * h), V::sub(a1, c1));
+            V::store(x + 2 * (j + 3 * h), V::sub(b1, d1));
+        }
+    }
+}
+
+template <typename V, typename T = typename V::value_type>
+constexpr kernels<T> make_kernels(const char *name) {
+    return {name, V::lanes, radix2_stage<V>, radix4_stage<V>, power_loop<T>,
+            decibels_loop<T>, power_db_loop<T>, smooth_loop<T>};
+}
+
+} // namespace
+} // namespace keyq::simd
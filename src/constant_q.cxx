@@ -0,0 +1,286 @@
+#include "../include/constant_q.h"
+
+#include "dft.h"
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <map>
+#include <mutex>
+#include <numbers>
+#include <stdexcept>
+
+namespace keyq {
+
+// Each bin's spectral kernel is the run of transform bins [first, first + count) where it
+// isn't negligible, conjugated and scaled so the bin is its dot product with the spectrum.
+// The runs are packed end to end in weights.
+template <typename T>
+struct constant_q<T>::kernel {
+    int fft_size;
+    int bins_per_octave;
+    std::vector<double> frequency;
+    std::vector<int> pitch_class;
+    std::vector<int> first;
+    std::vector<int> count;
+    std::vector<size_t> offset;
+    std::vector<complex> weights;
+};
+
+namespace {
+
+struct kernel_key {
+    double sample_rate;
+    double low;
+    int octaves;
+    int bins_per_octave;
+    double threshold;
+
+    auto operator<=>(const kernel_key &) const = default;
+};
+
+// Q is the bin spacing's reciprocal, and the lowest bin has the longest window: q cycles
+double quality(int bins_per_octave) {
+    return 1 / (std::exp2(1.0 / bins_per_octave) - 1);
+}
+
+template <typename T>
+double window_length(const typename constant_q<T>::config &c) {
+    return std::ceil(quality(c.bins_per_octave) * c.sample_rate / c.low);
+}
+
+constexpr double max_fft_size = 1 << 30;
+
+template <typename T>
+void validate(const typename constant_q<T>::config &c) {
+    const bool sizes = c.octaves >= 1 && c.bins_per_octave >= 1 && c.hop >= 1;
+    if (!(c.sample_rate > 0) || !(c.low > 0) || !sizes || !(c.threshold >= 0) ||
+        !(c.threshold < 1))
+        throw std::invalid_argument("constant_q: needs sample_rate > 0, low > 0, octaves, "
+                                    "bins_per_octave and hop >= 1, 0 <= threshold < 1");
+
+    // The top bin reaches half a bin spacing above its centre
+    const double top = c.low * std::exp2(c.octaves - 0.5 / c.bins_per_octave);
+    if (top >= c.sample_rate / 2)
+        throw std::invalid_argument("constant_q: top bin is above Nyquist");
+
+    // The lowest bin's window sets the transform size; see shared
+    if (!(window_length<T>(c) <= max_fft_size))
+        throw std::invalid_argument("constant_q: the lowest bin needs a transform over 2^30");
+}
+
+// Nearest equal-tempered semitone, as a pitch class with C = 0
+int nearest_pitch_class(double hz) {
+    const long semitones = std::lround(12 * std::log2(hz / 440.0)) + 9;
+    return static_cast<int>(((semitones % 12) + 12) % 12);
+}
+
+} // namespace
+
+template <typename T>
+std::shared_ptr<const typename constant_q<T>::kernel> constant_q<T>::shared(const config &c) {
+    static std::mutex mutex;
+    static std::map<kernel_key, std::weak_ptr<const kernel>> cache;
+
+    const kernel_key key{c.sample_rate, c.low, c.octaves, c.bins_per_octave, c.threshold};
+    {
+        const std::lock_guard lock(mutex);
+        if (auto found = cache[key].lock())
+            return found;
+    }
+
+    // Built outside the lock so other configurations aren't held up; if two threads race to
+    // build the same one, the first stored is kept. The transform is the next power of two
+    // that holds the longest window.
+    const int b = c.bins_per_octave;
+    const int bins = c.octaves * b;
+    const double q = quality(b);
+    const int n = static_cast<int>(std::bit_ceil(static_cast<unsigned>(window_length<T>(c))));
+    const int half = n / 2;
+
+    auto made = std::make_shared<kernel>();
+    made->fft_size = n;
+    made->bins_per_octave = b;
+
+    const dft<double> engine(n, -1);
+    std::vector<std::complex<double>> temporal(n), spectral(n);
+    std::vector<std::complex<double>> scratch(engine.scratch_size());
+    for (int k = 0; k < bins; ++k) {
+        const double hz = c.low * std::exp2(static_cast<double>(k) / b);
+        made->frequency.push_back(hz);
+        made->pitch_class.push_back(nearest_pitch_class(hz));
+
+        // Hamming-windowed q cycles of the bin's frequency, centred in the frame and scaled
+        // by the window's sum so a sinusoid's amplitude a reads as a/2
+        const int length = static_cast<int>(std::ceil(q * c.sample_rate / hz));
+        const int start = (n - length) / 2;
+        std::vector<double> window(length);
+        for (int i = 0; i < length; ++i)
+            window[i] = 0.54 - 0.46 * std::cos(2 * std::numbers::pi * i / length);
+        double sum = 0;
+        for (const double w : window)
+            sum += w;
+        std::fill(temporal.begin(), temporal.end(), std::complex<double>{});
+        for (int i = 0; i < length; ++i) {
+            const double phase = 2 * std::numbers::pi * q * i / length;
+            temporal[start + i] = std::polar(window[i] / sum, phase);
+        }
+        engine.execute(temporal.data(), spectral.data(), scratch.data());
+
+        // By Parseval, the bin is sum_j X[j] conj(K[j]) / n. A real signal's spectrum only
+        // has its positive half given, which is where the kernel's energy is.
+        double peak = 0;
+        for (int j = 0; j <= half; ++j)
+            peak = std::max(peak, std::abs(spectral[j]));
+        int first = 0;
+        int last = half;
+        while (first < half && std::abs(spectral[first]) < c.threshold * peak)
+            ++first;
+        while (last > first && std::abs(spectral[last]) < c.threshold * peak)
+            --last;
+        made->first.push_back(first);
+        made->count.push_back(last - first + 1);
+        made->offset.push_back(made->weights.size());
+        for (int j = first; j <= last; ++j)
+            made->weights.push_back(static_cast<complex>(std::conj(spectral[j]) / double(n)));
+    }
+
+    const std::lock_guard lock(mutex);
+    if (auto found = cache[key].lock())
+        return found;
+    cache[key] = made;
+    return made;
+}
+
+template <typename T>
+constant_q<T>::constant_q(const config &c)
+    : kernel_((validate<T>(c), shared(c))),
+      frames_({kernel_->fft_size, c.hop, window::rectangular}),
+      values_(kernel_->first.size()) {}
+
+template <typename T>
+constant_q<T>::~constant_q() = default;
+
+template <typename T>
+int constant_q<T>::bins() const {
+    return static_cast<int>(kernel_->first.size());
+}
+
+template <typename T>
+int constant_q<T>::bins_per_octave() const {
+    return kernel_->bins_per_octave;
+}
+
+template <typename T>
+int constant_q<T>::fft_size() const {
+    return kernel_->fft_size;
+}
+
+template <typename T>
+double constant_q<T>::frequency(int bin) const {
+    return kernel_->frequency[bin];
+}
+
+template <typename T>
+int constant_q<T>::pitch_class(int bin) const {
+    return kernel_->pitch_class[bin];
+}
+
+template <typename T>
+void constant_q<T>::transform(std::span<const complex> spectrum, std::span<complex> out) const {
+    const kernel &k = *kernel_;
+    const T *x = reinterpret_cast<const T *>(spectrum.data());
+    const T *weights = reinterpret_cast<const T *>(k.weights.data());
+    for (size_t bin = 0; bin < k.first.size(); ++bin) {
+        // Split real and imaginary sums over two accumulators each, so the adds overlap
+        const T *s = x + 2 * static_cast<size_t>(k.first[bin]);
+        const T *w = weights + 2 * k.offset[bin];
+        const int count = k.count[bin];
+        T re[2] = {}, im[2] = {};
+        int j = 0;
+        for (; j + 1 < count; j += 2) {
+            for (int lane = 0; lane < 2; ++lane) {
+                const T sr = s[2 * (j + lane)], si = s[2 * (j + lane) + 1];
+                const T wr = w[2 * (j + lane)], wi = w[2 * (j + lane) + 1];
+                re[lane] += sr * wr - si * wi;
+                im[lane] += sr * wi + si * wr;
+            }
+        }
+        if (j < count) {
+            const T sr = s[2 * j], si = s[2 * j + 1];
+            const T wr = w[2 * j], wi = w[2 * j + 1];
+            re[0] += sr * wr - si * wi;
+            im[0] += sr * wi + si * wr;
+        }
+        out[bin] = {re[0] + re[1], im[0] + im[1]};
+    }
+}
+
+template <typename T>
+void constant_q<T>::chroma(std::span<const complex> values, std::span<T> out) const {
+    std::fill_n(out.begin(), 12, T(0));
+    for (size_t bin = 0; bin < values.size(); ++bin)
+        out[kernel_->pitch_class[bin]] += std::abs(values[bin]);
+}
+
+template class constant_q<float>;
+template class constant_q<double>;
+
+namespace {
+
+// Krumhansl and Kessler's probe-tone ratings for C major and C minor
+constexpr double major_profile[12] = {6.35, 2.23, 3.48, 2.33, 4.38, 4.09,
+                                      2.52, 5.19, 2.39, 3.66, 2.29, 2.88};
+constexpr double minor_profile[12] = {6.33, 2.68, 3.52, 5.38, 2.60, 3.53,
+                                      2.54, 4.75, 3.98, 2.69, 3.34, 3.17};
+
+// Pearson correlation of chroma with a profile moved up to tonic
+template <typename T>
+double correlate(std::span<const T> chroma, const double (&profile)[12], int tonic) {
+    double mean_c = 0, mean_p = 0;
+    for (int i = 0; i < 12; ++i) {
+        mean_c += chroma[i];
+        mean_p += profile[i];
+    }
+    mean_c /= 12;
+    mean_p /= 12;
+    double cross = 0, var_c = 0, var_p = 0;
+    for (int i = 0; i < 12; ++i) {
+        const double dc = chroma[(i + tonic) % 12] - mean_c;
+        const double dp = profile[i] - mean_p;
+        cross += dc * dp;
+        var_c += dc * dc;
+        var_p += dp * dp;
+    }
+    return var_c > 0 ? cross / std::sqrt(var_c * var_p) : 0;
+}
+
+template <typename T>
+musical_key best_key(std::span<const T> chroma, std::span<double> scores) {
+    if (chroma.size() != 12 || (!scores.empty() && scores.size() != 24))
+        throw std::invalid_argument("find_key: needs 12 chroma values and 0 or 24 scores");
+
+    musical_key best{0, false, -2};
+    for (int minor = 0; minor < 2; ++minor) {
+        for (int tonic = 0; tonic < 12; ++tonic) {
+            const double r = correlate(chroma, minor ? minor_profile : major_profile, tonic);
+            if (!scores.empty())
+                scores[12 * minor + tonic] = r;
+            if (r > best.correlation)
+                best = {tonic, minor == 1, r};
+        }
+    }
+    return best;
+}
+
+} // namespace
+
+musical_key find_key(std::span<const float> chroma, std::span<double> scores) {
+    return best_key(chroma, scores);
+}
+
+musical_key find_key(std::span<const double> chroma, std::span<double> scores) {
+    return best_key(chroma, scores);
+}
+
+} // namespace keyq
@@ -0,0 +1,184 @@
+#include "../include/convolver.h"
+
+#include "dft.h"
+#include "memory.h"
+
+#include <algorithm>
+#include <complex>
+#include <stdexcept>
+
+namespace keyq {
+
+namespace {
+
+// Storage from the library's allocator, aligned for the SIMD kernels
+template <typename U>
+using buffer = memory::vector<U>;
+
+// sum += x * h over n complex values, on interleaved parts so it vectorises
+template <typename T>
+void multiply_add(const std::complex<T> *x, const std::complex<T> *h, std::complex<T> *sum,
+                  size_t n) {
+    const T *a = reinterpret_cast<const T *>(x);
+    const T *b = reinterpret_cast<const T *>(h);
+    T *s = reinterpret_cast<T *>(sum);
+    for (size_t i = 0; i < 2 * n; i += 2) {
+        s[i] += a[i] * b[i] - a[i + 1] * b[i + 1];
+        s[i + 1] += a[i] * b[i + 1] + a[i + 1] * b[i];
+    }
+}
+
+} // namespace
+
+// Overlap-save over one segment of the response, starting offset taps in, with partitions
+// of size block. The segment's output z is computed block samples at a time and kept in a
+// ring long enough to be read offset samples late: the convolver adds z(n - offset) to
+// output n. That is in time as long as offset >= block - base, where base is the
+// convolver's block size.
+template <typename T>
+struct convolver<T>::stage {
+    using complex = std::complex<T>;
+
+    stage(std::span<const T> segment, size_t offset, int block, int base)
+        : block(block), bins(block + 1), offset(offset),
+          partitions((segment.size() + block - 1) / block), transform(2 * block, -1),
+          inverse(2 * block, 1), input(2 * block), spectra(partitions * bins),
+          delay_line(partitions * bins), sum(bins), result(2 * block),
+          scratch(std::max(transform.scratch_size(), inverse.scratch_size())),
+          ring(offset + base) {
+        // Partition spectra, with the inverse transform's 1/2b folded in
+        const T scale = T(1) / (2 * block);
+        for (size_t p = 0; p < partitions; ++p) {
+            std::fill(result.begin(), result.end(), T(0));
+            const size_t begin = p * block;
+            const size_t end = std::min(segment.size(), begin + block);
+            std::copy(segment.begin() + begin, segment.begin() + end, result.begin());
+            complex *h = spectra.data() + p * bins;
+            transform.forward(result.data(), h, scratch.data());
+            for (size_t k = 0; k < bins; ++k)
+                h[k] *= scale;
+        }
+    }
+
+    // Take base samples; once a whole block has arrived, convolve it into the ring
+    void push(const T *in, int base) {
+        std::copy(in, in + base, input.begin() + block + fill);
+        fill += base;
+        if (fill < block)
+            return;
+        fill = 0;
+
+        // The newest input spectrum goes in the delay line's head slot; partition p meets
+        // the spectrum from p blocks ago
+        transform.forward(input.data(), delay_line.data() + head * bins, scratch.data());
+        std::fill(sum.begin(), sum.end(), complex{});
+        for (size_t p = 0, slot = head; p < partitions; ++p) {
+            multiply_add(delay_line.data() + slot * bins, spectra.data() + p * bins, sum.data(),
+                         bins);
+            slot = slot == 0 ? partitions - 1 : slot - 1;
+        }
+        head = head + 1 == partitions ? 0 : head + 1;
+
+        // The second half of the circular result is the linear convolution
+        inverse.backward(sum.data(), result.data(), scratch.data());
+        size_t pos = written % ring.size();
+        for (int i = 0; i < block; ++i) {
+            ring[pos] = result[block + i];
+            if (++pos == ring.size())
+                pos = 0;
+        }
+        written += block;
+        std::copy(input.begin() + block, input.end(), input.begin());
+    }
+
+    // out[i] += z(time + i - offset); indices before the start read as silence
+    void add_to(T *out, size_t time, int base) const {
+        size_t pos = (time + ring.size() - offset) % ring.size();
+        for (int i = 0; i < base; ++i) {
+            out[i] += ring[pos];
+            if (++pos == ring.size())
+                pos = 0;
+        }
+    }
+
+    void reset() {
+        std::fill(input.begin(), input.end(), T(0));
+        std::fill(delay_line.begin(), delay_line.end(), complex{});
+        std::fill(ring.begin(), ring.end(), T(0));
+        fill = 0;
+        head = 0;
+        written = 0;
+    }
+
+    int block;
+    size_t bins;
+    size_t offset;
+    size_t partitions;
+    rdft<T> transform;
+    rdft<T> inverse;
+
+    int fill = 0;       // samples of the current block received
+    size_t head = 0;    // delay line slot for the next input spectrum
+    size_t written = 0; // ring samples produced so far
+
+    buffer<T> input; // previous block then the current one
+    buffer<complex> spectra;
+    buffer<complex> delay_line;
+    buffer<complex> sum;
+    buffer<T> result;
+    buffer<complex> scratch;
+    buffer<T> ring;
+};
+
+template <typename T>
+convolver<T>::convolver(std::span<const T> impulse_response, const config &c)
+    : block_size_(c.block_size) {
+    if (impulse_response.empty() || c.block_size < 1)
+        throw std::invalid_argument("convolver: needs a response and a block size of at least 1");
+
+    const size_t length = impulse_response.size();
+    if (!c.non_uniform) {
+        stages_.push_back(std::make_unique<stage>(impulse_response, 0, block_size_, block_size_));
+        return;
+    }
+
+    // Stage s has blocks of base * 2^s and covers twice that, starting at (2^(s+1) - 2) base
+    // taps, which keeps every offset at least block - base; the largest takes the rest
+    int largest = block_size_;
+    while (largest <= c.max_block_size / 2)
+        largest *= 2;
+    size_t offset = 0;
+    for (int block = block_size_; offset < length; block = std::min(2 * block, largest)) {
+        const size_t rest = length - offset;
+        const size_t span = block == largest ? rest : std::min(rest, 2 * size_t(block));
+        stages_.push_back(std::make_unique<stage>(impulse_response.subspan(offset, span), offset,
+                                                  block, block_size_));
+        offset += span;
+    }
+}
+
+template <typename T>
+convolver<T>::~convolver() = default;
+
+template <typename T>
+void convolver<T>::process(const T *in, T *out) {
+    // Every stage takes the input before any output is written, so in may alias out
+    for (auto &s : stages_)
+        s->push(in, block_size_);
+    std::fill(out, out + block_size_, T(0));
+    for (const auto &s : stages_)
+        s->add_to(out, time_, block_size_);
+    time_ += block_size_;
+}
+
+template <typename T>
+void convolver<T>::reset() {
+    for (auto &s : stages_)
+        s->reset();
+    time_ = 0;
+}
+
+template class convolver<float>;
+template class convolver<double>;
+
+} // namespace keyq
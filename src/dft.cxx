@@ -0,0 +1,1059 @@
+#include "dft.h"
+
+#include "kernels.h"
+#include "planner.h"
+#include "thread_pool.h"
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <numbers>
+#include <utility>
+
+namespace keyq {
+
+namespace {
+
+// Plain complex multiply; std::complex operator* adds NaN recovery we don't want here
+template <typename C>
+inline C mul(const C &a, const C &b) {
+    return {a.real() * b.real() - a.imag() * b.imag(), a.real() * b.imag() + a.imag() * b.real()};
+}
+
+template <typename C>
+inline C conj_mul(const C &a, const C &b) {
+    return {a.real() * b.real() + a.imag() * b.imag(), a.imag() * b.real() - a.real() * b.imag()};
+}
+
+// exp(sign * 2 pi i * k / n), with k reduced first so large products stay exact. Always
+// evaluated in double so float tables are correctly rounded.
+template <typename T = double>
+inline std::complex<T> root(long long k, long long n, int sign) {
+    const double angle = sign * 2.0 * std::numbers::pi * static_cast<double>(k % n) / n;
+    return {static_cast<T>(std::cos(angle)), static_cast<T>(std::sin(angle))};
+}
+
+bool is_power_of_2(int n) {
+    return n > 0 && (n & (n - 1)) == 0;
+}
+
+// Largest prime handled by a mixed-radix butterfly; anything bigger goes to Bluestein
+constexpr int max_radix = 13;
+
+// Four-step moves its columns in strips of 512 bytes, eight cache lines: wide enough that
+// each row it visits, a page or more from the last, pays for its TLB and cache misses
+template <typename T>
+constexpr size_t strip = 512 / sizeof(std::complex<T>);
+
+// Rows ahead to prefetch when walking down the columns of a large grid
+constexpr size_t prefetch_distance = 16;
+
+inline void prefetch(const void *p) {
+#if defined(__GNUC__)
+    __builtin_prefetch(p);
+#else
+    (void)p;
+#endif
+}
+
+// Largest size estimate hands to a compile-time transform; above it the runtime-dispatched
+// SIMD kernels win, though measuring still times the specialisations up to their limit
+constexpr int fixed_threshold = 32;
+
+// Smallest 1D size worth splitting four-step across threads, and the shortest side allowed
+constexpr int parallel_threshold = 1 << 14;
+constexpr int min_side = 16;
+
+// Bytes of data above which a single thread takes powers of two four-step too. Radix-2
+// streams the whole array through memory once per pair of stages, while four-step
+// transforms columns and rows in cache and moves the data a fixed five times; below this
+// the strided moves cost more than the passes they save. Other sizes stay on Stockham,
+// which sorts itself and measured faster than four-step at every size tried.
+constexpr size_t cache_threshold = size_t{32} << 20;
+
+// Largest divisor of n no greater than sqrt(n)
+int balanced_divisor(int n) {
+    int best = 1;
+    for (int d = 2; static_cast<long long>(d) * d <= n; ++d)
+        if (n % d == 0)
+            best = d;
+    return best;
+}
+
+// Split n into Stockham radices, fours first. Returns empty if a prime factor is too big.
+std::vector<int> factorise(int n) {
+    std::vector<int> radices;
+    while (n % 4 == 0) {
+        radices.push_back(4);
+        n /= 4;
+    }
+    for (int r = 2; r <= max_radix && n > 1; ++r) {
+        while (n % r == 0) {
+            radices.push_back(r);
+            n /= r;
+        }
+    }
+    if (n > 1)
+        return {};
+    return radices;
+}
+
+// Butterflies read r inputs a[t] and write b[u] = sum_t a[t] * w^(t u), w = exp(sign 2 pi i / r)
+
+template <typename C>
+inline void butterfly2(C *a) {
+    const C t = a[0];
+    a[0] = t + a[1];
+    a[1] = t - a[1];
+}
+
+template <typename C>
+inline void butterfly3(C *a, int sign) {
+    using T = typename C::value_type;
+    const T s60 = sign * T(0.86602540378443864676); // sign * sin(2 pi / 3)
+    const C t1 = a[1] + a[2];
+    const C t2 = a[0] - T(0.5) * t1;
+    const C d = a[1] - a[2];
+    const C t3 = {-s60 * d.imag(), s60 * d.real()};
+    a[0] += t1;
+    a[1] = t2 + t3;
+    a[2] = t2 - t3;
+}
+
+template <typename C>
+inline void butterfly4(C *a, int sign) {
+    using T = typename C::value_type;
+    const C t0 = a[0] + a[2];
+    const C t1 = a[0] - a[2];
+    const C t2 = a[1] + a[3];
+    const C d = a[1] - a[3];
+    const C t3 = {-T(sign) * d.imag(), T(sign) * d.real()};
+    a[0] = t0 + t2;
+    a[1] = t1 + t3;
+    a[2] = t0 - t2;
+    a[3] = t1 - t3;
+}
+
+// Odd radix via symmetric pairs: b[u] = a0 + sum_t (a[t] + a[r-t]) cos + i (a[t] - a[r-t]) sin
+template <int R, typename C>
+inline void butterfly_odd(C *a, int r, const C *roots) {
+    const int radix = R ? R : r;
+    const int half = (radix - 1) / 2;
+    C sum[max_radix / 2 + 1];
+    C diff[max_radix / 2 + 1];
+    C b[max_radix];
+
+    C dc = a[0];
+    for (int t = 1; t <= half; ++t) {
+        sum[t] = a[t] + a[radix - t];
+        diff[t] = a[t] - a[radix - t];
+        dc += sum[t];
+    }
+    for (int u = 1; u <= half; ++u) {
+        C re = a[0];
+        C im{};
+        for (int t = 1; t <= half; ++t) {
+            const C &w = roots[(t * u) % radix];
+            re += w.real() * sum[t];
+            im += w.imag() * diff[t];
+        }
+        // i * im
+        const C rot = {-im.imag(), im.real()};
+        b[u] = re + rot;
+        b[radix - u] = re - rot;
+    }
+    a[0] = dc;
+    for (int u = 1; u < radix; ++u)
+        a[u] = b[u];
+}
+
+} // namespace
+
+namespace {
+
+// Factorisations worth timing for mixed radix: fours first (the heuristic), all twos,
+// largest radix first, and at exhaustive effort every distinct ordering up to a cap
+std::vector<std::vector<int>> orderings(int n, rigor effort) {
+    std::vector<std::vector<int>> list;
+    auto radices = factorise(n);
+    if (radices.empty())
+        return list;
+    list.push_back(radices);
+    if (effort < rigor::patient)
+        return list;
+
+    std::vector<int> twos;
+    for (const int r : radices) {
+        twos.push_back(r == 4 ? 2 : r);
+        if (r == 4)
+            twos.push_back(2);
+    }
+    std::sort(twos.begin(), twos.end());
+    list.push_back(twos);
+    list.emplace_back(radices.rbegin(), radices.rend());
+    std::sort(radices.begin(), radices.end());
+    list.push_back(radices);
+
+    if (effort == rigor::exhaustive) {
+        constexpr size_t cap = 64;
+        for (size_t i = 0; i < cap && std::next_permutation(radices.begin(), radices.end()); ++i)
+            list.push_back(radices);
+    }
+
+    std::vector<std::vector<int>> unique;
+    for (auto &order : list)
+        if (std::find(unique.begin(), unique.end(), order) == unique.end())
+            unique.push_back(std::move(order));
+    return unique;
+}
+
+// A recipe from wisdom may be for another build or CPU; only use it if it fits n
+template <typename T>
+bool fits(const recipe &r, int n) {
+    switch (r.algorithm) {
+        case algorithm::radix2:
+            if (r.kernels.empty())
+                return n <= 1 || is_power_of_2(n);
+            for (const auto *k : simd::available<T>())
+                if (r.kernels == k->name)
+                    return n <= 1 || is_power_of_2(n);
+            return false;
+        case algorithm::mixed_radix: {
+            long long product = 1;
+            for (const int radix : r.radices) {
+                if (radix < 2 || radix > max_radix)
+                    return false;
+                product *= radix;
+            }
+            return !r.radices.empty() && product == n;
+        }
+        case algorithm::bluestein:
+            return n > 1;
+        case algorithm::four_step:
+            return r.radices.size() == 1 && r.radices[0] >= min_side &&
+                   n % r.radices[0] == 0 && n / r.radices[0] >= min_side;
+        case algorithm::fixed:
+            return find_fixed<T>(n, -1) != nullptr;
+    }
+    return false;
+}
+
+} // namespace
+
+template <typename T>
+recipe dft<T>::heuristic(int n, int threads) {
+    const bool large = is_power_of_2(n) &&
+                       static_cast<size_t>(n) * sizeof(std::complex<T>) > cache_threshold;
+    if (n >= parallel_threshold && (threads > 1 || large)) {
+        if (const int n1 = balanced_divisor(n); n1 >= min_side)
+            return {algorithm::four_step, {}, {n1}};
+    }
+    if (n <= fixed_threshold && find_fixed<T>(n, -1))
+        return {algorithm::fixed, {}, {}};
+    if (n <= 1 || is_power_of_2(n))
+        return {algorithm::radix2, {}, {}};
+    if (auto radices = factorise(n); !radices.empty())
+        return {algorithm::mixed_radix, {}, std::move(radices)};
+    return {algorithm::bluestein, {}, {}};
+}
+
+template <typename T>
+std::vector<recipe> dft<T>::candidates(int n, int threads, rigor effort) {
+    std::vector<recipe> list{heuristic(n, threads)};
+    auto add = [&](recipe r) {
+        if (std::find(list.begin(), list.end(), r) == list.end())
+            list.push_back(std::move(r));
+    };
+
+    if (n >= 2 && is_power_of_2(n))
+        for (const auto *k : simd::available<T>())
+            add({algorithm::radix2, k->name, {}});
+    if (find_fixed<T>(n, -1))
+        add({algorithm::fixed, {}, {}});
+    if (n >= parallel_threshold)
+        if (const int n1 = balanced_divisor(n); n1 >= min_side)
+            add({algorithm::four_step, {}, {n1}});
+    for (auto &order : orderings(n, effort))
+        add({algorithm::mixed_radix, {}, std::move(order)});
+    if (n > 1 && (effort >= rigor::patient || factorise(n).empty()))
+        add({algorithm::bluestein, {}, {}});
+    return list;
+}
+
+template <typename T>
+dft<T>::dft(int n, int sign, int threads, rigor effort)
+    : dft(n, sign, threads, planner::choose<T>(n, sign, threads, effort)) {}
+
+template <typename T>
+dft<T>::dft(int n, int sign, int threads, const recipe &r)
+    : n_(n), sign_(sign < 0 ? -1 : 1), threads_(threads) {
+    const recipe plan = fits<T>(r, n) ? r : heuristic(n, threads);
+    algorithm_ = plan.algorithm;
+
+    // Four-step: with n = n1 n2 and j = j1 n2 + j2, X[k1 + n1 k2] is an n2-point transform
+    // over j2 of w_n^(j2 k1) times the n1-point transform over j1 of column j2
+    if (algorithm_ == algorithm::four_step) {
+        const int n1 = plan.radices[0];
+        const int n2 = n / n1;
+        inner_.reserve(2);
+        inner_.emplace_back(n1, sign_);
+        inner_.emplace_back(n2, sign_);
+
+        // w_n^m for m = j2 k1 < n, as fine[m mod 2^b] * coarse[m >> b]: two tables of about
+        // sqrt(n) rather than one of n, which at 16M points would be another 256 MB
+        fine_bits_ = (std::bit_width(static_cast<unsigned>(n - 1)) + 1) / 2;
+        const long long fine = 1LL << fine_bits_;
+        const long long coarse = (n + fine - 1) / fine;
+        twiddles_.resize(fine + coarse);
+        for (long long m = 0; m < fine; ++m)
+            twiddles_[m] = root<T>(m, n, sign_);
+        for (long long h = 0; h < coarse; ++h)
+            twiddles_[fine + h] = root<T>(h * fine, n, sign_);
+        return;
+    }
+
+    if (algorithm_ == algorithm::fixed) {
+        fixed_ = find_fixed<T>(n, sign_);
+        return;
+    }
+
+    if (algorithm_ == algorithm::radix2) {
+        if (n < 2)
+            return;
+
+        bitrev_.resize(n);
+        int bits = 0;
+        while ((1 << bits) < n)
+            ++bits;
+        for (int i = 0; i < n; ++i) {
+            int r = 0;
+            for (int b = 0; b < bits; ++b)
+                r |= ((i >> b) & 1) << (bits - 1 - b);
+            bitrev_[i] = r;
+        }
+
+        // Each twiddle is evaluated directly rather than by recurrence for full precision
+        twiddles_.resize(n - 1);
+        for (int len = 2; len <= n; len <<= 1) {
+            complex *stage = twiddles_.data() + len / 2 - 1;
+            for (int j = 0; j < len / 2; ++j)
+                stage[j] = root<T>(j, len, sign_);
+        }
+        kernels_ = &simd::best<T>();
+        for (const auto *k : simd::available<T>())
+            if (plan.kernels == k->name)
+                kernels_ = k;
+        return;
+    }
+
+    if (algorithm_ == algorithm::mixed_radix) {
+        int len = n;
+        int stride = 1;
+        passes_.reserve(plan.radices.size());
+        for (const int r : plan.radices) {
+            pass p{r, len / r, stride, {}, {}};
+            p.twiddles.resize(static_cast<size_t>(p.m) * (r - 1));
+            for (int q = 0; q < p.m; ++q)
+                for (int u = 1; u < r; ++u)
+                    p.twiddles[q * (r - 1) + u - 1] =
+                        root<T>(static_cast<long long>(q) * u, len, sign_);
+            p.roots.resize(r);
+            for (int u = 0; u < r; ++u)
+                p.roots[u] = root<T>(u, r, sign_);
+            passes_.push_back(std::move(p));
+            len /= r;
+            stride *= r;
+        }
+        return;
+    }
+
+    // Bluestein: x_k w^(jk) = c_k sum_j (x_j c_j) conj(c_(k-j)) with c_k = exp(sign pi i k^2 / n),
+    // evaluated as a cyclic convolution of power-of-2 length m >= 2n - 1
+    int m = 1;
+    while (m < 2 * n - 1)
+        m <<= 1;
+    inner_.emplace_back(m, -1, threads);
+
+    chirp_.resize(n);
+    for (int k = 0; k < n; ++k)
+        chirp_[k] = root<T>(static_cast<long long>(k) * k, 2LL * n, sign_);
+
+    // The kernel is transformed once in double, whatever T is, and the inverse transform's
+    // 1/m folded in. That transform is temporary, so it stays out of any arena.
+    const memory::scope detached(nullptr);
+    std::vector<std::complex<double>> b(m, 0.0);
+    b[0] = 1.0;
+    for (int k = 1; k < n; ++k)
+        b[k] = b[m - k] = std::conj(root(static_cast<long long>(k) * k, 2LL * n, sign_));
+
+    const dft<double> fft(m, -1);
+    std::vector<std::complex<double>> work(fft.scratch_size());
+    fft.execute(b.data(), b.data(), work.data());
+    kernel_.resize(m);
+    for (int k = 0; k < m; ++k)
+        kernel_[k] = complex(b[k] / static_cast<double>(m));
+}
+
+template <typename T>
+size_t dft<T>::scratch_size() const {
+    switch (algorithm_) {
+        case algorithm::mixed_radix:
+        case algorithm::fixed:
+            return n_;
+        case algorithm::bluestein:
+            return inner_[0].size() + inner_[0].scratch_size();
+        case algorithm::four_step:
+            // The grid, then room for the steps to run inline
+            return n_ + std::max(strip<T> * inner_[0].size() + inner_[0].scratch_size(),
+                                 inner_[1].scratch_size());
+        default:
+            return 0;
+    }
+}
+
+template <typename T>
+std::string dft<T>::describe() const {
+    std::string text = algorithm_names[static_cast<int>(algorithm_)];
+    switch (algorithm_) {
+        case algorithm::radix2:
+            if (kernels_)
+                text += std::string(" ") + kernels_->name;
+            break;
+        case algorithm::mixed_radix:
+            for (const pass &p : passes_)
+                text += ' ' + std::to_string(p.radix);
+            break;
+        case algorithm::bluestein:
+            text += ' ' + std::to_string(inner_[0].size());
+            break;
+        case algorithm::four_step:
+            text += ' ' + std::to_string(inner_[0].size()) + ' ' + std::to_string(inner_[1].size());
+            break;
+        case algorithm::fixed:
+            break;
+    }
+    return text;
+}
+
+template <typename T>
+void dft<T>::execute(const complex *in, complex *out, complex *scratch) const {
+    switch (algorithm_) {
+        case algorithm::radix2:
+            radix2(in, out);
+            break;
+        case algorithm::mixed_radix:
+            stockham(in, out, scratch);
+            break;
+        case algorithm::bluestein:
+            bluestein(in, out, scratch);
+            break;
+        case algorithm::four_step:
+            four_step(in, out, scratch);
+            break;
+        case algorithm::fixed:
+            // Out of place only, so an in-place call transforms a copy
+            if (in == out) {
+                std::copy(in, in + n_, scratch);
+                in = scratch;
+            }
+            fixed_(in, out);
+            break;
+    }
+}
+
+template <typename T>
+void dft<T>::radix2(const complex *in, complex *out) const {
+    const int n = n_;
+    if (n <= 1) {
+        if (n == 1)
+            out[0] = in[0];
+        return;
+    }
+
+    // Bit-reversal permutation, fusing the copy when out-of-place
+    const int *rev = bitrev_.data();
+    if (in != out) {
+        for (int i = 0; i < n; ++i)
+            out[i] = in[rev[i]];
+    } else {
+        for (int i = 0; i < n; ++i)
+            if (i < rev[i])
+                std::swap(out[i], out[rev[i]]);
+    }
+
+    // Stages run as fused radix-4 pairs, with one leading radix-2 stage when log2(n) is odd
+    auto *data = reinterpret_cast<T *>(out);
+    const auto *w = reinterpret_cast<const T *>(twiddles_.data());
+    size_t h = 1;
+    if (std::countr_zero(static_cast<unsigned>(n)) % 2 != 0) {
+        kernels_->radix2(data, n, 1, w);
+        h = 2;
+    }
+    for (; h < static_cast<size_t>(n); h *= 4)
+        kernels_->radix4(data, n, h, w + 2 * (h - 1), w + 2 * (2 * h - 1), sign_);
+}
+
+namespace {
+
+// One Stockham pass with the radix fixed at compile time (R = 0 for a runtime radix)
+template <int R, typename C>
+void stockham_pass(const C *x, C *y, int r, int m, int s, const C *twiddles, const C *roots,
+                   int sign) {
+    const int radix = R ? R : r;
+    C a[max_radix];
+
+    for (int p = 0; p < m; ++p) {
+        const C *w = twiddles + static_cast<size_t>(p) * (radix - 1);
+        const C *src = x + static_cast<size_t>(s) * p;
+        C *dst = y + static_cast<size_t>(s) * radix * p;
+
+        for (int q = 0; q < s; ++q) {
+            for (int t = 0; t < radix; ++t)
+                a[t] = src[q + static_cast<size_t>(s) * t * m];
+
+            if constexpr (R == 2)
+                butterfly2(a);
+            else if constexpr (R == 3)
+                butterfly3(a, sign);
+            else if constexpr (R == 4)
+                butterfly4(a, sign);
+            else
+                butterfly_odd<R>(a, radix, roots);
+
+            dst[q] = a[0];
+            for (int u = 1; u < radix; ++u)
+                dst[q + s * u] = mul(a[u], w[u - 1]);
+        }
+    }
+}
+
+} // namespace
+
+// Self-sorting Stockham: each pass reads x[q + s(p + t m)] and writes the twiddled radix-r
+// butterfly to y[q + s(r p + u)], so no separate digit-reversal is needed
+template <typename T>
+void dft<T>::stockham(const complex *in, complex *out, complex *scratch) const {
+    const size_t count = passes_.size();
+    if (count == 0) {
+        out[0] = in[0];
+        return;
+    }
+
+    // Alternate buffers so the last pass lands in out; in-place odd counts start from scratch
+    const complex *x = in;
+    if (in == out && count % 2 == 1) {
+        std::copy(in, in + n_, scratch);
+        x = scratch;
+    }
+
+    for (size_t i = 0; i < count; ++i) {
+        const pass &ps = passes_[i];
+        complex *y = ((count - 1 - i) % 2 == 0) ? out : scratch;
+        const complex *w = ps.twiddles.data();
+        const complex *roots = ps.roots.data();
+
+        switch (ps.radix) {
+            case 2:
+                stockham_pass<2>(x, y, 2, ps.m, ps.stride, w, roots, sign_);
+                break;
+            case 3:
+                stockham_pass<3>(x, y, 3, ps.m, ps.stride, w, roots, sign_);
+                break;
+            case 4:
+                stockham_pass<4>(x, y, 4, ps.m, ps.stride, w, roots, sign_);
+                break;
+            case 5:
+                stockham_pass<5>(x, y, 5, ps.m, ps.stride, w, roots, sign_);
+                break;
+            case 7:
+                stockham_pass<7>(x, y, 7, ps.m, ps.stride, w, roots, sign_);
+                break;
+            default:
+                stockham_pass<0>(x, y, ps.radix, ps.m, ps.stride, w, roots, sign_);
+                break;
+        }
+        x = y;
+    }
+}
+
+template <typename T>
+void dft<T>::bluestein(const complex *in, complex *out, complex *scratch) const {
+    const int n = n_;
+    const dft &fft = inner_[0];
+    const int m = fft.size();
+
+    for (int k = 0; k < n; ++k)
+        scratch[k] = mul(in[k], chirp_[k]);
+    std::fill(scratch + n, scratch + m, complex{});
+
+    fft.execute(scratch, scratch, scratch + m);
+
+    // Inverse via conj(F(conj(z))); the 1/m is already in the kernel
+    for (int k = 0; k < m; ++k)
+        scratch[k] = std::conj(mul(scratch[k], kernel_[k]));
+    fft.execute(scratch, scratch, scratch + m);
+
+    for (int k = 0; k < n; ++k)
+        out[k] = conj_mul(chirp_[k], scratch[k]);
+}
+
+// Columns are gathered a strip at a time, transformed, twiddled and stored as rows of the
+// n1 x n2 grid; rows are then transformed in place and written out transposed, a strip of
+// rows at a time so each write run covers a whole strip. Both steps run on the pool.
+template <typename T>
+void dft<T>::four_step(const complex *in, complex *out, complex *scratch) const {
+    const dft &cols = inner_[0];
+    const dft &rows = inner_[1];
+    const size_t n1 = cols.size();
+    const size_t n2 = rows.size();
+    complex *grid = scratch;
+    complex *rest = scratch + n_;
+
+    const size_t columns = strip<T>;
+    const complex *fine = twiddles_.data();
+    const complex *coarse = fine + (size_t{1} << fine_bits_);
+    const size_t mask = (size_t{1} << fine_bits_) - 1;
+
+    const size_t col_tiles = (n2 + columns - 1) / columns;
+    split<T>(threads_, col_tiles, columns * n1 + cols.scratch_size(), rest,
+             [&](size_t begin, size_t end, complex *local) {
+                 complex *buffer = local;
+                 complex *work = local + columns * n1;
+                 for (size_t t = begin; t < end; ++t) {
+                     const size_t c = t * columns;
+                     const size_t width = std::min(columns, n2 - c);
+
+                     for (size_t j1 = 0; j1 < n1; ++j1) {
+                         const complex *src = in + j1 * n2 + c;
+                         if (j1 + prefetch_distance < n1)
+                             for (size_t b = 0; b < width; b += 64 / sizeof(complex))
+                                 prefetch(src + prefetch_distance * n2 + b);
+                         for (size_t b = 0; b < width; ++b)
+                             buffer[b * n1 + j1] = src[b];
+                     }
+
+                     for (size_t b = 0; b < width; ++b) {
+                         complex *z = buffer + b * n1;
+                         cols.execute(z, z, work);
+                         const size_t j2 = c + b;
+                         for (size_t k1 = 0, m = 0; k1 < n1; ++k1, m += j2)
+                             z[k1] = mul(z[k1], mul(fine[m & mask], coarse[m >> fine_bits_]));
+                     }
+
+                     for (size_t k1 = 0; k1 < n1; ++k1) {
+                         complex *dst = grid + k1 * n2 + c;
+                         for (size_t b = 0; b < width; ++b)
+                             dst[b] = buffer[b * n1 + k1];
+                     }
+                 }
+             });
+
+    const size_t row_tiles = (n1 + columns - 1) / columns;
+    split<T>(threads_, row_tiles, rows.scratch_size(), rest,
+             [&](size_t begin, size_t end, complex *work) {
+                 for (size_t t = begin; t < end; ++t) {
+                     const size_t r = t * columns;
+                     const size_t width = std::min(columns, n1 - r);
+
+                     for (size_t b = 0; b < width; ++b) {
+                         complex *z = grid + (r + b) * n2;
+                         rows.execute(z, z, work);
+                     }
+
+                     for (size_t k2 = 0; k2 < n2; ++k2) {
+                         complex *dst = out + k2 * n1 + r;
+                         for (size_t b = 0; b < width; ++b)
+                             dst[b] = grid[(r + b) * n2 + k2];
+                     }
+                 }
+             });
+}
+
+template <typename T>
+dft_nd<T>::dft_nd(const std::vector<int> &dims, int sign, int threads, rigor effort)
+    : dims_(dims), size_(1), threads_(dims.size() > 1 ? threads : 1) {
+    // A lone axis is threaded inside its engine; otherwise rows and tiles are split
+    const int inside = dims.size() > 1 ? 1 : threads;
+    for (const int n : dims_) {
+        size_ *= n;
+        std::shared_ptr<const dft<T>> engine;
+        for (size_t k = 0; k < axes_.size() && !engine; ++k)
+            if (dims_[k] == n)
+                engine = axes_[k];
+        if (!engine)
+            engine = std::make_shared<const dft<T>>(n, sign, inside, effort);
+        axes_.push_back(engine);
+    }
+}
+
+template <typename T>
+size_t dft_nd<T>::scratch_size() const {
+    size_t largest = 0;
+    for (size_t k = 0; k < axes_.size(); ++k) {
+        const size_t tiles = (k + 1 < axes_.size()) ? tile * dims_[k] : 0;
+        largest = std::max(largest, tiles + axes_[k]->scratch_size());
+    }
+    return largest;
+}
+
+template <typename T>
+std::string dft_nd<T>::describe() const {
+    std::string text;
+    for (const auto &engine : axes_)
+        text += (text.empty() ? "" : " x ") + engine->describe();
+    return text;
+}
+
+template <typename T>
+void dft_nd<T>::execute(const complex *in, complex *out, complex *scratch) const {
+    if (dims_.empty()) {
+        out[0] = in[0];
+        return;
+    }
+
+    // Last axis first, out-of-place from in, then every other axis in place on out
+    const int last = static_cast<int>(dims_.size()) - 1;
+    const dft<T> &row = *axes_[last];
+    const size_t n = dims_[last];
+    split<T>(threads_, size_ / n, row.scratch_size(), scratch,
+             [&](size_t begin, size_t end, complex *work) {
+                 for (size_t r = begin * n; r < end * n; r += n)
+                     row.execute(in + r, out + r, work);
+             });
+
+    for (int k = last - 1; k >= 0; --k)
+        axis(k, out, scratch);
+}
+
+template <typename T>
+void dft_nd<T>::axis(int k, complex *data, complex *scratch) const {
+    const dft<T> &engine = *axes_[k];
+    const size_t n = dims_[k];
+
+    size_t inner = 1;
+    for (size_t d = k + 1; d < dims_.size(); ++d)
+        inner *= dims_[d];
+    const size_t outer = size_ / (n * inner);
+    const size_t tiles = (inner + tile - 1) / tile;
+
+    split<T>(threads_, outer * tiles, tile * n + engine.scratch_size(), scratch,
+             [&](size_t begin, size_t end, complex *local) {
+                 complex *buffer = local;
+                 complex *work = local + tile * n;
+                 for (size_t t = begin; t < end; ++t) {
+                     complex *base = data + (t / tiles) * n * inner;
+                     const size_t c = (t % tiles) * tile;
+                     const size_t width = std::min(tile, inner - c);
+
+                     // Gather: each row of the tile is contiguous in memory
+                     for (size_t j = 0; j < n; ++j) {
+                         const complex *src = base + j * inner + c;
+                         for (size_t b = 0; b < width; ++b)
+                             buffer[b * n + j] = src[b];
+                     }
+
+                     for (size_t b = 0; b < width; ++b)
+                         engine.execute(buffer + b * n, buffer + b * n, work);
+
+                     for (size_t j = 0; j < n; ++j) {
+                         complex *dst = base + j * inner + c;
+                         for (size_t b = 0; b < width; ++b)
+                             dst[b] = buffer[b * n + j];
+                     }
+                 }
+             });
+}
+
+template <typename T>
+rdft<T>::rdft(int n, int sign, int threads, rigor effort)
+    : n_(n), fft_(n % 2 == 0 ? n / 2 : n, sign, threads, effort) {
+    if (n % 2 != 0)
+        return;
+    twiddles_.resize(n / 4 + 1);
+    for (int k = 0; k <= n / 4; ++k)
+        twiddles_[k] = root<T>(k, n, -1);
+}
+
+template <typename T>
+size_t rdft<T>::scratch_size() const {
+    // Odd sizes stage the whole complex sequence ahead of the inner transform's scratch
+    return fft_.scratch_size() + (n_ % 2 == 0 ? 0 : n_);
+}
+
+template <typename T>
+std::string rdft<T>::describe() const {
+    return fft_.describe();
+}
+
+// With z_k = x_2k + i x_2k+1 and Z = dft(z), the even/odd half spectra are
+// E_k = (Z_k + conj Z_h-k) / 2 and O_k = (Z_k - conj Z_h-k) / 2i, and X_k = E_k + W^k O_k.
+// Pairs (k, h - k) are finished together so the pass can run in place; at k = h/2 both
+// writes agree.
+template <typename T>
+void rdft<T>::forward(const T *in, complex *out, complex *scratch) const {
+    const int n = n_;
+    if (n % 2 != 0) {
+        complex *z = scratch + fft_.scratch_size();
+        for (int i = 0; i < n; ++i)
+            z[i] = {in[i], T(0)};
+        fft_.execute(z, z, scratch);
+        std::copy(z, z + n / 2 + 1, out);
+        return;
+    }
+
+    const int h = n / 2;
+    fft_.execute(reinterpret_cast<const complex *>(in), out, scratch);
+
+    const complex z0 = out[0];
+    out[0] = {z0.real() + z0.imag(), T(0)};
+    out[h] = {z0.real() - z0.imag(), T(0)};
+
+    for (int k = 1; k <= h / 2; ++k) {
+        const complex a = out[k];
+        const complex b = std::conj(out[h - k]);
+        const complex e = T(0.5) * (a + b);
+        const complex d = T(0.5) * (a - b);
+        const complex o = {d.imag(), -d.real()}; // d / i
+        const complex wo = mul(twiddles_[k], o);
+        out[k] = e + wo;
+        out[h - k] = std::conj(e - wo);
+    }
+}
+
+// Inverse of the above: rebuild Z_k = E_k + i O_k from the half spectrum, then one
+// n/2-point inverse transform leaves the samples interleaved in out
+template <typename T>
+void rdft<T>::backward(const complex *in, T *out, complex *scratch) const {
+    const int n = n_;
+    if (n % 2 != 0) {
+        complex *z = scratch + fft_.scratch_size();
+        for (int k = 0; k <= n / 2; ++k)
+            z[k] = in[k];
+        for (int k = n / 2 + 1; k < n; ++k)
+            z[k] = std::conj(in[n - k]);
+        fft_.execute(z, z, scratch);
+        for (int i = 0; i < n; ++i)
+            out[i] = z[i].real();
+        return;
+    }
+
+    const int h = n / 2;
+    auto *z = reinterpret_cast<complex *>(out);
+
+    const T x0 = in[0].real();
+    const T xh = in[h].real();
+    z[0] = {x0 + xh, x0 - xh};
+
+    for (int k = 1; k <= h / 2; ++k) {
+        const complex a = in[k];
+        const complex b = std::conj(in[h - k]);
+        const complex e = a + b;
+        const complex o = conj_mul(a - b, twiddles_[k]);
+        const complex io = {-o.imag(), o.real()};
+        z[k] = e + io;
+        z[h - k] = std::conj(e - io);
+    }
+
+    fft_.execute(z, z, scratch);
+}
+
+// Row-major offsets of every element of an array with extents dims laid out inside embed
+memory::table<ptrdiff_t> element_offsets(const std::vector<int> &dims,
+                                         const std::vector<int> &embed, int stride) {
+    const size_t rank = dims.size();
+    std::vector<ptrdiff_t> step(rank);
+    ptrdiff_t s = stride;
+    for (size_t k = rank; k-- > 0;) {
+        step[k] = s;
+        s *= embed.empty() ? dims[k] : embed[k];
+    }
+
+    size_t count = 1;
+    for (const int n : dims)
+        count *= n;
+
+    // Odometer over the index, carrying into outer axes as inner ones wrap
+    memory::table<ptrdiff_t> offsets(count);
+    std::vector<int> index(rank, 0);
+    ptrdiff_t offset = 0;
+    for (size_t i = 0; i < count; ++i) {
+        offsets[i] = offset;
+        for (size_t k = rank; k-- > 0;) {
+            offset += step[k];
+            if (++index[k] < dims[k])
+                break;
+            offset -= step[k] * dims[k];
+            index[k] = 0;
+        }
+    }
+    return offsets;
+}
+
+// Every transform of the batch is contiguous on its own
+bool is_contiguous(const std::vector<int> &dims, const std::vector<int> &embed, int stride) {
+    if (stride != 1)
+        return false;
+    for (size_t k = 1; k < embed.size(); ++k)
+        if (embed[k] != dims[k])
+            return false;
+    return true;
+}
+
+template <typename T>
+batch<T>::batch(kind k, const std::vector<int> &dims, int howmany, const layout &in,
+                const layout &out, int sign, T scale, int threads, rigor effort)
+    : kind_(k), n_(1), howmany_(howmany), in_(in), out_(out), scale_(scale),
+      threads_(howmany > 1 ? threads : 1) {
+    for (const int n : dims)
+        n_ *= n;
+
+    // Threads go across the batch, or inside the engine for a batch of one
+    const int inside = howmany > 1 ? 1 : threads;
+
+    // Extents of each side: the complex side of a real transform holds n/2+1 values
+    std::vector<int> in_dims = dims;
+    std::vector<int> out_dims = dims;
+    if (k == kind::c2c) {
+        dft_ = std::make_unique<dft_nd<T>>(dims, sign, inside, effort);
+        slot_ = n_;
+    } else {
+        rdft_ = std::make_unique<rdft<T>>(n_, k == kind::r2c ? -1 : 1, inside, effort);
+        (k == kind::r2c ? out_dims : in_dims) = {n_ / 2 + 1};
+        slot_ = n_ / 2 + 1;
+    }
+
+    direct_ = is_contiguous(in_dims, in_.embed, in_.stride) &&
+              is_contiguous(out_dims, out_.embed, out_.stride);
+    if (!direct_) {
+        in_offsets_ = element_offsets(in_dims, in_.embed, in_.stride);
+        out_offsets_ = element_offsets(out_dims, out_.embed, out_.stride);
+    }
+}
+
+template <typename T>
+size_t batch<T>::scratch_size() const {
+    const size_t engine = dft_ ? dft_->scratch_size() : rdft_->scratch_size();
+    return direct_ ? engine : tile * slot_ + engine;
+}
+
+template <typename T>
+std::string batch<T>::describe() const {
+    return dft_ ? dft_->describe() : rdft_->describe();
+}
+
+template <typename T>
+void batch<T>::execute(const T *in, T *out, complex *scratch) const {
+    if (direct_)
+        direct(in, out, scratch);
+    else
+        gathered(in, out, scratch);
+}
+
+template <typename T>
+void batch<T>::direct(const T *in, T *out, complex *scratch) const {
+    const auto *cin = reinterpret_cast<const complex *>(in);
+    auto *cout = reinterpret_cast<complex *>(out);
+    const size_t engine = dft_ ? dft_->scratch_size() : rdft_->scratch_size();
+
+    split<T>(threads_, howmany_, engine, scratch, [&](size_t begin, size_t end, complex *work) {
+        for (size_t b = begin; b < end; ++b) {
+            const ptrdiff_t i = static_cast<ptrdiff_t>(b) * in_.dist;
+            const ptrdiff_t o = static_cast<ptrdiff_t>(b) * out_.dist;
+            switch (kind_) {
+                case kind::c2c:
+                    dft_->execute(cin + i, cout + o, work);
+                    break;
+                case kind::r2c:
+                    rdft_->forward(in + i, cout + o, work);
+                    break;
+                case kind::c2r:
+                    rdft_->backward(cin + i, out + o, work);
+                    break;
+            }
+
+            if (scale_ != T(1)) {
+                if (kind_ == kind::c2r) {
+                    for (int j = 0; j < n_; ++j)
+                        out[o + j] *= scale_;
+                } else {
+                    for (size_t j = 0; j < slot_; ++j)
+                        cout[o + j] *= scale_;
+                }
+            }
+        }
+    });
+}
+
+// Gather up to a tile of transforms into contiguous slots, transform each slot in place and
+// scatter back. Element j of every transform in the tile is read before element j + 1, so an
+// interleaved layout (dist 1) streams through memory. Tiles are independent and run on the
+// pool when threaded.
+template <typename T>
+void batch<T>::gathered(const T *in, T *out, complex *scratch) const {
+    const auto *cin = reinterpret_cast<const complex *>(in);
+    auto *cout = reinterpret_cast<complex *>(out);
+    const size_t in_count = in_offsets_.size();
+    const size_t out_count = out_offsets_.size();
+    const size_t tiles = (howmany_ + tile - 1) / tile;
+
+    split<T>(threads_, tiles, scratch_size(), scratch,
+             [&](size_t begin, size_t end, complex *local) {
+                 complex *buffer = local;
+                 complex *work = local + tile * slot_;
+                 for (size_t t = begin; t < end; ++t) {
+                     const int b0 = static_cast<int>(t * tile);
+                     const int width = std::min(static_cast<int>(tile), howmany_ - b0);
+                     const ptrdiff_t ibase = static_cast<ptrdiff_t>(b0) * in_.dist;
+                     const ptrdiff_t obase = static_cast<ptrdiff_t>(b0) * out_.dist;
+
+                     for (size_t j = 0; j < in_count; ++j) {
+                         for (int b = 0; b < width; ++b) {
+                             const ptrdiff_t i =
+                                 ibase + static_cast<ptrdiff_t>(b) * in_.dist + in_offsets_[j];
+                             if (kind_ == kind::r2c)
+                                 reinterpret_cast<T *>(buffer + b * slot_)[j] = in[i];
+                             else
+                                 buffer[b * slot_ + j] = cin[i];
+                         }
+                     }
+
+                     for (int b = 0; b < width; ++b) {
+                         complex *z = buffer + b * slot_;
+                         switch (kind_) {
+                             case kind::c2c:
+                                 dft_->execute(z, z, work);
+                                 break;
+                             case kind::r2c:
+                                 rdft_->forward(reinterpret_cast<const T *>(z), z, work);
+                                 break;
+                             case kind::c2r:
+                                 rdft_->backward(z, reinterpret_cast<T *>(z), work);
+                                 break;
+                         }
+                     }
+
+                     for (size_t j = 0; j < out_count; ++j) {
+                         for (int b = 0; b < width; ++b) {
+                             const ptrdiff_t o =
+                                 obase + static_cast<ptrdiff_t>(b) * out_.dist + out_offsets_[j];
+                             if (kind_ == kind::c2r)
+                                 out[o] = reinterpret_cast<const T *>(buffer + b * slot_)[j] *
+                                          scale_;
+                             else
+                                 cout[o] = buffer[b * slot_ + j] * scale_;
+                         }
+                     }
+                 }
+             });
+}
+
+template class dft<float>;
+template class dft<double>;
+template class dft_nd<float>;
+template class dft_nd<double>;
+template class rdft<float>;
+template class rdft<double>;
+template class batch<float>;
+template class batch<double>;
+
+} // namespace keyq
@@ -0,0 +1,289 @@
+#pragma once
+
+#include "memory.h"
+#include "thread_pool.h"
+
+#include <complex>
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace keyq {
+
+namespace simd {
+template <typename T>
+struct kernels;
+}
+
+enum class algorithm { radix2, mixed_radix, bluestein, four_step, fixed };
+
+// Indexed by algorithm, as written in wisdom and stats
+inline constexpr const char *algorithm_names[] = {"radix2", "mixed_radix", "bluestein",
+                                                  "four_step", "fixed"};
+
+// A compile-time transform from include/fft.h, out of place
+template <typename T>
+using fixed_transform = void (*)(const std::complex<T> *, std::complex<T> *);
+
+// The one for size n and direction sign, or null if n has no specialisation
+template <typename T>
+fixed_transform<T> find_fixed(int n, int sign);
+
+// How hard the planner searches: estimate uses wisdom or heuristics, the others time
+// progressively more candidates (FFTW_MEASURE, FFTW_PATIENT, FFTW_EXHAUSTIVE)
+enum class rigor { estimate, measure, patient, exhaustive };
+
+// Everything the planner can choose for one 1D size: the algorithm, the kernel set for
+// radix-2 (empty for the best this CPU has) and the pass order for mixed radix, or n1 for
+// four-step. This is what wisdom stores.
+struct recipe {
+    keyq::algorithm algorithm;
+    std::string kernels;
+    std::vector<int> radices;
+
+    bool operator==(const recipe &) const = default;
+};
+
+// Unnormalised 1D complex transform of fixed size and direction. All tables are built by
+// the constructor and execute() never writes to the object, so one instance can be shared
+// between plans and threads. T is float or double; tables are computed in double.
+// Sizes too big for the cache are split four-step into columns and rows that fit in it, run
+// on the pool when threads > 1; so are all large sizes when threaded.
+template <typename T>
+class dft {
+  public:
+    using complex = std::complex<T>;
+
+    using algorithm = keyq::algorithm;
+
+    // Engine from wisdom, heuristics or measurement, depending on effort
+    dft(int n, int sign, int threads = 1, rigor effort = rigor::estimate);
+
+    // Engine built to a given recipe; one that doesn't fit n falls back to the heuristic
+    dft(int n, int sign, int threads, const recipe &r);
+
+    // What estimate picks without wisdom, and what the planner times at each effort, the
+    // heuristic first
+    static recipe heuristic(int n, int threads);
+    static std::vector<recipe> candidates(int n, int threads, rigor effort);
+
+    int size() const { return n_; }
+    algorithm kind() const { return algorithm_; }
+
+    // What was built, e.g. "radix2 avx2", "mixed_radix 4 3 5" or "fixed"
+    std::string describe() const;
+
+    // Number of complex elements execute() needs in its scratch buffer
+    size_t scratch_size() const;
+
+    // Transform in to out; in may equal out
+    void execute(const complex *in, complex *out, complex *scratch) const;
+
+  private:
+    // One Stockham autosort pass of radix r over sub-transforms of length r * m
+    struct pass {
+        int radix;
+        int m;
+        int stride;
+        memory::table<complex> twiddles; // m * (radix - 1), indexed [p * (radix - 1) + u - 1]
+        memory::table<complex> roots;    // radix-th roots of unity for the butterfly
+    };
+
+    void radix2(const complex *in, complex *out) const;
+    void stockham(const complex *in, complex *out, complex *scratch) const;
+    void bluestein(const complex *in, complex *out, complex *scratch) const;
+    void four_step(const complex *in, complex *out, complex *scratch) const;
+
+    int n_;
+    int sign_;
+    int threads_;
+    algorithm algorithm_;
+
+    // Radix-2: bit-reversal index, per-stage twiddles (stage len starts at len/2 - 1) and the
+    // butterfly kernels for this CPU. Four-step: w_n^m for m < 2^fine_bits, then w_n^(m 2^b).
+    memory::table<int> bitrev_;
+    memory::table<complex> twiddles_;
+    const simd::kernels<T> *kernels_ = nullptr;
+    int fine_bits_ = 0;
+
+    // Fixed: the specialisation for this size and direction
+    fixed_transform<T> fixed_ = nullptr;
+
+    // Mixed radix: Stockham passes, smallest stride first
+    memory::table<pass> passes_;
+
+    // Bluestein: chirp, transformed convolution kernel and a power-of-2 inner transform.
+    // Four-step: the n1-point column and n2-point row transforms.
+    memory::table<complex> chirp_;
+    memory::table<complex> kernel_;
+    memory::table<dft> inner_;
+};
+
+// Row-major multi-dimensional complex transform, computed row-column: the contiguous last
+// axis is transformed row by row, every other axis in tiles of adjacent columns that are
+// gathered into contiguous scratch, transformed and scattered back, so each cache line
+// fetched from a column serves a whole tile. Equal extents share one engine. With
+// threads > 1, rows and tiles are spread over the pool; a 1D transform is threaded inside.
+template <typename T>
+class dft_nd {
+  public:
+    using complex = std::complex<T>;
+
+    dft_nd(const std::vector<int> &dims, int sign, int threads = 1,
+           rigor effort = rigor::estimate);
+
+    size_t size() const { return size_; }
+    size_t scratch_size() const;
+
+    // Each axis's engine, outermost first, joined by " x "
+    std::string describe() const;
+
+    void execute(const complex *in, complex *out, complex *scratch) const;
+
+  private:
+    // Transform axis k of data in place
+    void axis(int k, complex *data, complex *scratch) const;
+
+    std::vector<int> dims_;
+    std::vector<std::shared_ptr<const dft<T>>> axes_;
+    size_t size_;
+    int threads_;
+};
+
+// Real-data transform of length n. Even sizes pack the samples into an n/2-point complex
+// dft and untangle the result with one twiddle pass; odd sizes fall back to a full complex
+// transform. The spectrum uses FFTW's n/2+1 Hermitian layout and nothing is normalised.
+template <typename T>
+class rdft {
+  public:
+    using complex = std::complex<T>;
+
+    // sign FFTW_FORWARD builds r2c, FFTW_BACKWARD builds c2r
+    rdft(int n, int sign, int threads = 1, rigor effort = rigor::estimate);
+
+    int size() const { return n_; }
+    size_t scratch_size() const;
+    std::string describe() const;
+
+    // r2c: n reals in, n/2+1 complex out; in may alias out (FFTW's padded in-place layout)
+    void forward(const T *in, complex *out, complex *scratch) const;
+
+    // c2r: n/2+1 complex in, n reals out; in is left untouched unless it aliases out
+    void backward(const complex *in, T *out, complex *scratch) const;
+
+  private:
+    int n_;
+    dft<T> fft_;                    // n/2 points when n is even, n points otherwise
+    memory::table<complex> twiddles_; // exp(-2 pi i k / n) for k <= n/4
+};
+
+enum class kind { c2c, r2c, c2r };
+
+// Row-major offsets of every element of an array with extents dims laid out inside embed
+// (empty for dims itself), stride elements apart at the innermost level
+memory::table<ptrdiff_t> element_offsets(const std::vector<int> &dims,
+                                         const std::vector<int> &embed, int stride);
+
+// Every array of a batch with this layout is contiguous on its own
+bool is_contiguous(const std::vector<int> &dims, const std::vector<int> &embed, int stride);
+
+// Columns gathered per tile; 8 complex values span one (float) or two (double) cache lines
+inline constexpr size_t tile = 8;
+
+// Per-thread scratch for the caller of an execute(), so plans stay read-only during
+// execution: any number of threads may execute one plan at once, each on its own arrays
+template <typename T>
+std::complex<T> *thread_scratch(size_t n) {
+    thread_local memory::vector<std::complex<T>> buffer;
+    if (buffer.size() < n)
+        buffer.resize(n);
+    return buffer.data();
+}
+
+// Scratch for work run on the pool, kept apart from thread_scratch and from the buffer the
+// caller's execute() was handed since the calling thread runs tasks too
+template <typename T>
+std::complex<T> *task_scratch(size_t n) {
+    thread_local memory::vector<std::complex<T>> buffer;
+    if (buffer.size() < n)
+        buffer.resize(n);
+    return buffer.data();
+}
+
+// Run body(begin, end, scratch) over [0, count): inline on the caller's scratch when
+// single-threaded, otherwise across the pool with size elements of scratch per thread
+template <typename T, typename F>
+void split(int threads, size_t count, size_t size, std::complex<T> *scratch, const F &body) {
+    if (threads <= 1 || count <= 1) {
+        body(size_t{0}, count, scratch);
+        return;
+    }
+    pool::parallel_for(threads, count, [&](size_t begin, size_t end) {
+        body(begin, end, task_scratch<T>(size));
+    });
+}
+
+// howmany equal transforms over arbitrarily strided arrays, as in FFTW's advanced interface:
+// element i of transform b lives at b * dist + stride * offset(i), with offset(i) row-major
+// over the embedding extents. Batches whose transforms are each contiguous run straight
+// through the engine; any other layout is gathered a tile of transforms at a time into
+// scratch, so each cache line read from an interleaved layout serves the whole tile.
+// Results are multiplied by scale on the way out. Real kinds are one-dimensional. With
+// threads > 1 a batch is spread over the pool by transform or tile, and a single transform
+// is threaded inside.
+template <typename T>
+class batch {
+  public:
+    using complex = std::complex<T>;
+
+    // One array's layout; an empty embed means the transform's own extents. Offsets count
+    // elements of the array's type, real or complex.
+    struct layout {
+        std::vector<int> embed;
+        int stride = 1;
+        int dist = 0;
+    };
+
+    batch(kind k, const std::vector<int> &dims, int howmany, const layout &in,
+          const layout &out, int sign, T scale, int threads = 1,
+          rigor effort = rigor::estimate);
+
+    size_t scratch_size() const;
+    std::string describe() const;
+
+    // in and out point at the arrays' first real; complex arrays are interleaved
+    void execute(const T *in, T *out, complex *scratch) const;
+
+  private:
+    void direct(const T *in, T *out, complex *scratch) const;
+    void gathered(const T *in, T *out, complex *scratch) const;
+
+    kind kind_;
+    int n_;       // logical size of one transform
+    int howmany_;
+    layout in_;
+    layout out_;
+    T scale_;
+    int threads_;
+    bool direct_;
+    size_t slot_; // complex elements per transform in the gather buffer
+
+    // Element offsets of one transform in each array, only when gathering
+    memory::table<ptrdiff_t> in_offsets_;
+    memory::table<ptrdiff_t> out_offsets_;
+
+    std::unique_ptr<dft_nd<T>> dft_;
+    std::unique_ptr<rdft<T>> rdft_;
+};
+
+extern template class dft<float>;
+extern template class dft<double>;
+extern template class dft_nd<float>;
+extern template class dft_nd<double>;
+extern template class rdft<float>;
+extern template class rdft<double>;
+extern template class batch<float>;
+extern template class batch<double>;
+
+} // namespace keyq
@@ -0,0 +1,213 @@
+#include "../include/executor.h"
+
+#include "../include/spectrum.h"
+#include "dft.h"
+#include "window.h"
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+namespace keyq {
+
+namespace {
+
+// Jobs that can share a transform and window
+struct shape {
+    int size;
+    keyq::window window;
+
+    auto operator<=>(const shape &) const = default;
+};
+
+} // namespace
+
+template <typename T>
+struct executor<T>::state {
+    struct entry {
+        job work;
+        callback done;
+        uint64_t sequence; // submission order, to find the oldest job across shapes
+    };
+
+    struct engine {
+        rdft<T> transform;
+        std::vector<T> window; // empty for rectangular
+
+        explicit engine(const shape &s)
+            : transform(s.size, -1),
+              window(s.window == window::rectangular ? std::vector<T>{}
+                                                     : make_window<T>(s.window, s.size)) {}
+    };
+
+    int max_batch;
+
+    mutable std::mutex mutex;
+    std::condition_variable wake;
+    std::map<shape, std::deque<entry>> queued;
+    std::map<shape, std::shared_ptr<const engine>> engines;
+    size_t count = 0; // entries in queued
+    uint64_t next = 0;
+    bool stopping = false;
+
+    std::vector<std::thread> workers;
+
+    void work();
+    std::shared_ptr<const engine> find(const shape &s);
+};
+
+// An engine is built outside the lock; if two workers race, the first one stored is kept
+template <typename T>
+auto executor<T>::state::find(const shape &s) -> std::shared_ptr<const engine> {
+    {
+        const std::lock_guard lock(mutex);
+        if (const auto it = engines.find(s); it != engines.end())
+            return it->second;
+    }
+    auto made = std::make_shared<const engine>(s);
+    const std::lock_guard lock(mutex);
+    return engines.try_emplace(s, std::move(made)).first->second;
+}
+
+template <typename T>
+void executor<T>::state::work() {
+    memory::vector<T> frame;
+    memory::vector<complex> bins;
+    memory::vector<complex> scratch;
+    std::vector<entry> batch;
+
+    for (;;) {
+        shape key{};
+        {
+            std::unique_lock lock(mutex);
+            wake.wait(lock, [&] { return stopping || count > 0; });
+            if (count == 0)
+                return;
+
+            // The shape with the oldest job, and an even share of its queue between the
+            // workers so that one batch doesn't hold jobs the others could be running
+            auto oldest = queued.begin();
+            for (auto it = queued.begin(); it != queued.end(); ++it)
+                if (it->second.front().sequence < oldest->second.front().sequence)
+                    oldest = it;
+            key = oldest->first;
+            std::deque<entry> &q = oldest->second;
+            const size_t share = (q.size() + workers.size() - 1) / workers.size();
+            const size_t take = std::min(share, static_cast<size_t>(max_batch));
+            for (size_t i = 0; i < take; ++i) {
+                batch.push_back(std::move(q.front()));
+                q.pop_front();
+            }
+            if (q.empty())
+                queued.erase(oldest);
+            count -= take;
+        }
+
+        std::shared_ptr<const engine> e;
+        try {
+            e = find(key);
+        } catch (...) {
+            for (entry &item : batch)
+                item.done(std::current_exception());
+            batch.clear();
+            continue;
+        }
+
+        const size_t n = key.size;
+        const size_t half = n / 2 + 1;
+        frame.resize(n);
+        bins.resize(half);
+        scratch.resize(e->transform.scratch_size());
+        for (entry &item : batch) {
+            const job &j = item.work;
+            const T *in = j.samples;
+            if (!e->window.empty()) {
+                for (size_t i = 0; i < n; ++i)
+                    frame[i] = in[i] * e->window[i];
+                in = frame.data();
+            }
+            complex *out = j.spectrum ? j.spectrum : bins.data();
+            e->transform.forward(in, out, scratch.data());
+            if (j.decibels) {
+                const T scale = T(1) / (static_cast<T>(n) * static_cast<T>(n));
+                spectrum::power_db(std::span<const complex>(out, half),
+                                   std::span<T>(j.decibels, half), scale, j.floor);
+            }
+            item.done(nullptr);
+        }
+        batch.clear();
+    }
+}
+
+template <typename T>
+executor<T>::executor(const config &c) : state_(std::make_unique<state>()) {
+    if (c.threads < 0 || c.max_batch < 1)
+        throw std::invalid_argument("executor: threads must be at least 0 and max_batch 1");
+
+    const int hardware = static_cast<int>(std::thread::hardware_concurrency());
+    const int threads = c.threads > 0 ? c.threads : std::max(1, hardware);
+    state_->max_batch = c.max_batch;
+    for (int i = 0; i < threads; ++i)
+        state_->workers.emplace_back([s = state_.get()] { s->work(); });
+}
+
+template <typename T>
+executor<T>::~executor() {
+    {
+        const std::lock_guard lock(state_->mutex);
+        state_->stopping = true;
+    }
+    state_->wake.notify_all();
+    for (auto &t : state_->workers)
+        t.join();
+}
+
+template <typename T>
+int executor<T>::threads() const {
+    return static_cast<int>(state_->workers.size());
+}
+
+template <typename T>
+size_t executor<T>::pending() const {
+    const std::lock_guard lock(state_->mutex);
+    return state_->count;
+}
+
+template <typename T>
+void executor<T>::submit(const job &j, callback done) {
+    if (!j.samples || j.size < 2 || (!j.spectrum && !j.decibels))
+        throw std::invalid_argument(
+            "executor: a job needs samples, size >= 2 and a spectrum or decibels");
+
+    {
+        const std::lock_guard lock(state_->mutex);
+        state_->queued[{j.size, j.window}].push_back({j, std::move(done), state_->next++});
+        ++state_->count;
+    }
+    state_->wake.notify_one();
+}
+
+template <typename T>
+std::future<void> executor<T>::submit(const job &j) {
+    // Shared, since a std::function has to be copyable and a promise can only be moved
+    auto promise = std::make_shared<std::promise<void>>();
+    std::future<void> result = promise->get_future();
+    submit(j, [promise](std::exception_ptr e) {
+        if (e)
+            promise->set_exception(e);
+        else
+            promise->set_value();
+    });
+    return result;
+}
+
+template class executor<float>;
+template class executor<double>;
+
+} // namespace keyq
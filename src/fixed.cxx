@@ -0,0 +1,41 @@
+#include "../include/fft.h"
+
+#include "dft.h"
+
+#include <array>
+#include <bit>
+#include <utility>
+
+namespace keyq {
+
+namespace {
+
+// Powers of two up to 2048 are compiled in: the plugins' 2048 and 512-point frames, the
+// half-size complex transforms behind their real ones, and everything smaller. Each size
+// carries its own constant twiddle table, so the library grows with the largest.
+constexpr int max_log2 = 11;
+
+template <typename T, direction D, size_t... L>
+constexpr std::array<fixed_transform<T>, sizeof...(L)> specialisations(std::index_sequence<L...>) {
+    return {&fft<size_t{1} << L, T, D>::execute...};
+}
+
+} // namespace
+
+template <typename T>
+fixed_transform<T> find_fixed(int n, int sign) {
+    static constexpr auto forward =
+        specialisations<T, direction::forward>(std::make_index_sequence<max_log2 + 1>{});
+    static constexpr auto backward =
+        specialisations<T, direction::backward>(std::make_index_sequence<max_log2 + 1>{});
+
+    if (n < 1 || n > (1 << max_log2) || !std::has_single_bit(static_cast<unsigned>(n)))
+        return nullptr;
+    const int log2 = std::countr_zero(static_cast<unsigned>(n));
+    return sign < 0 ? forward[log2] : backward[log2];
+}
+
+template fixed_transform<float> find_fixed<float>(int, int);
+template fixed_transform<double> find_fixed<double>(int, int);
+
+} // namespace keyq
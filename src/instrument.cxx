@@ -0,0 +1,21 @@
+#include "instrument.h"
+
+#include <cstdlib>
+#include <cstring>
+
+namespace keyq::instrument {
+
+namespace {
+
+// Set and not "0"
+bool from_environment(const char *name) {
+    const char *value = std::getenv(name);
+    return value && *value && std::strcmp(value, "0") != 0;
+}
+
+} // namespace
+
+std::atomic<bool> stats_enabled{compiled && from_environment("KEYQ_STATS")};
+std::atomic<bool> trace_enabled{compiled && from_environment("KEYQ_TRACE")};
+
+} // namespace keyq::instrument
@@ -0,0 +1,118 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <print>
+#include <string>
+#include <utility>
+
+// Built in unless configured with -DKEYQ_INSTRUMENTATION=OFF
+#ifndef KEYQ_INSTRUMENT
+#define KEYQ_INSTRUMENT 1
+#endif
+
+// Opt-in instrumentation for the C API: per-plan counters and a trace of API calls on
+// stderr, each switched on at run time by the API or the environment (KEYQ_STATS, KEYQ_TRACE).
+// Switched off, a hook costs one relaxed load; compiled out, every hook is empty.
+namespace keyq::instrument {
+
+inline constexpr bool compiled = KEYQ_INSTRUMENT != 0;
+
+extern std::atomic<bool> stats_enabled;
+extern std::atomic<bool> trace_enabled;
+
+inline bool collecting() {
+    if constexpr (compiled)
+        return stats_enabled.load(std::memory_order_relaxed);
+    return false;
+}
+
+inline bool tracing() {
+    if constexpr (compiled)
+        return trace_enabled.load(std::memory_order_relaxed);
+    return false;
+}
+
+// One line on stderr; the arguments aren't formatted unless tracing is on
+template <typename... Args>
+void trace(std::format_string<Args...> fmt, Args &&...args) {
+    if constexpr (compiled)
+        if (tracing())
+            std::println(stderr, fmt, std::forward<Args>(args)...);
+}
+
+#if KEYQ_INSTRUMENT
+
+// A plan's counters. Atomic because one plan may be executed from several threads at once.
+struct counters {
+    std::string algorithm;
+    uint64_t bytes_per_run = 0; // input and output array bytes of one execution
+
+    std::atomic<uint64_t> executions{0};
+    std::atomic<uint64_t> total_ns{0};
+    std::atomic<uint64_t> min_ns{UINT64_MAX};
+    std::atomic<uint64_t> max_ns{0};
+
+    void record(uint64_t ns) {
+        executions.fetch_add(1, std::memory_order_relaxed);
+        total_ns.fetch_add(ns, std::memory_order_relaxed);
+        for (uint64_t low = min_ns.load(std::memory_order_relaxed);
+             ns < low && !min_ns.compare_exchange_weak(low, ns, std::memory_order_relaxed);)
+            ;
+        for (uint64_t high = max_ns.load(std::memory_order_relaxed);
+             ns > high && !max_ns.compare_exchange_weak(high, ns, std::memory_order_relaxed);)
+            ;
+    }
+
+    void reset() {
+        executions = 0;
+        total_ns = 0;
+        min_ns = UINT64_MAX;
+        max_ns = 0;
+    }
+};
+
+// Times one execution into c if stats or trace are on when it starts
+class timed {
+  public:
+    explicit timed(counters &c) : counters_(c), active_(collecting() || tracing()) {
+        if (active_)
+            start_ = clock::now();
+    }
+
+    ~timed() {
+        if (!active_)
+            return;
+        const auto ns = static_cast<uint64_t>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(clock::now() - start_).count());
+        if (collecting())
+            counters_.record(ns);
+        trace("execute: {} in {} ns", counters_.algorithm, ns);
+    }
+
+    timed(const timed &) = delete;
+    timed &operator=(const timed &) = delete;
+
+  private:
+    using clock = std::chrono::steady_clock;
+
+    counters &counters_;
+    bool active_;
+    clock::time_point start_;
+};
+
+#else
+
+struct counters {
+    void reset() {}
+};
+
+struct timed {
+    explicit timed(counters &) {}
+};
+
+#endif
+
+} // namespace keyq::instrument
@@ -0,0 +1,61 @@
+#include "kernels.h"
+
+#include "butterflies.h"
+
+#include <cstdlib>
+#include <cstring>
+
+namespace keyq::simd {
+
+template <typename T>
+const kernels<T> &scalar() {
+    static constexpr kernels<T> k = make_kernels<scalar_vec<T>>("scalar");
+    return k;
+}
+
+template <typename T>
+std::vector<const kernels<T> *> available() {
+    std::vector<const kernels<T> *> list{&scalar<T>()};
+#ifdef KEYQ_HAVE_SSE2
+    list.push_back(&sse2<T>());
+#endif
+#ifdef KEYQ_HAVE_AVX2
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"))
+        list.push_back(&avx2<T>());
+#endif
+#ifdef KEYQ_HAVE_AVX512
+    if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx2") &&
+        __builtin_cpu_supports("fma"))
+        list.push_back(&avx512<T>());
+#endif
+#ifdef KEYQ_HAVE_NEON
+    list.push_back(&neon<T>());
+#endif
+    return list;
+}
+
+template <typename T>
+static const kernels<T> &select() {
+    const auto list = available<T>();
+    if (const char *isa = std::getenv("KEYQ_ISA")) {
+        for (const kernels<T> *k : list)
+            if (std::strcmp(k->name, isa) == 0)
+                return *k;
+    }
+    return *list.back();
+}
+
+template <typename T>
+const kernels<T> &best() {
+    static const kernels<T> &chosen = select<T>();
+    return chosen;
+}
+
+template const kernels<float> &scalar<float>();
+template const kernels<double> &scalar<double>();
+template std::vector<const kernels<float> *> available<float>();
+template std::vector<const kernels<double> *> available<double>();
+template const kernels<float> &best<float>();
+template const kernels<double> &best<double>();
+
+} // namespace keyq::simd
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+namespace keyq::simd {
+
+// Butterfly kernels for one instruction set, operating in place on interleaved complex
+// values of type T (float or double), and the spectrum post-processing loops. Each
+// instruction set is compiled in its own translation unit with its own target flags and
+// picked at runtime, so one binary runs at full width on every CPU.
+template <typename T>
+struct kernels {
+    const char *name;
+    int lanes; // complex values per vector register
+
+    // Radix-2 DIT stage: for each block of 2h, x[j], x[j+h] += -/ w[j] x[j+h]
+    void (*radix2)(T *data, size_t n, size_t h, const T *w);
+
+    // Two fused radix-2 stages of lengths 2h and 4h, with twiddles w2 = w_2h^j, w4 = w_4h^j
+    void (*radix4)(T *data, size_t n, size_t h, const T *w2, const T *w4, int sign);
+
+    // Over n bins: |x|^2 scale from interleaved complex; 10 log10 of power, floored at floor
+    // dB; both fused; and attack/release smoothing of state towards in
+    void (*power)(const T *bins, T *out, size_t n, T scale);
+    void (*decibels)(const T *power, T *out, size_t n, T floor);
+    void (*power_db)(const T *bins, T *out, size_t n, T scale, T floor);
+    void (*smooth)(const T *in, T *state, size_t n, T attack, T release);
+};
+
+// Defined and instantiated for float and double in each instruction set's own file
+template <typename T>
+const kernels<T> &scalar();
+#ifdef KEYQ_HAVE_SSE2
+template <typename T>
+const kernels<T> &sse2();
+#endif
+#ifdef KEYQ_HAVE_AVX2
+template <typename T>
+const kernels<T> &avx2();
+#endif
+#ifdef KEYQ_HAVE_AVX512
+template <typename T>
+const kernels<T> &avx512();
+#endif
+#ifdef KEYQ_HAVE_NEON
+template <typename T>
+const kernels<T> &neon();
+#endif
+
+// Kernel sets built into the library that this CPU can run, narrowest first
+template <typename T>
+std::vector<const kernels<T> *> available();
+
+// Widest available set, or the one named by the KEYQ_ISA environment variable
+template <typename T>
+const kernels<T> &best();
+
+} // namespace keyq::simd
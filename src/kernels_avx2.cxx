@@ -0,0 +1,16 @@
+#include "butterflies.h"
+
+#include "avx2_vec.h"
+
+namespace keyq::simd {
+
+template <typename T>
+const kernels<T> &avx2() {
+    static constexpr kernels<T> k = make_kernels<avx2_vec<T>>("avx2");
+    return k;
+}
+
+template const kernels<float> &avx2<float>();
+template const kernels<double> &avx2<double>();
+
+} // namespace keyq::simd
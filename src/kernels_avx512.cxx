@@ -0,0 +1,73 @@
+#include "avx2_vec.h"
+#include "butterflies.h"
+
+#include <immintrin.h>
+
+namespace keyq::simd {
+namespace {
+
+template <typename T>
+struct avx512_vec;
+
+// Four complex doubles per register; short stages drop to AVX2
+template <>
+struct avx512_vec<double> {
+    using value_type = double;
+    using narrow = avx2_vec<double>;
+    static constexpr int lanes = 4;
+    using reg = __m512d;
+
+    static reg load(const double *p) { return _mm512_loadu_pd(p); }
+    static void store(double *p, reg a) { _mm512_storeu_pd(p, a); }
+    static reg add(reg a, reg b) { return _mm512_add_pd(a, b); }
+    static reg sub(reg a, reg b) { return _mm512_sub_pd(a, b); }
+    static reg cmul(reg a, reg w) {
+        const reg wr = _mm512_unpacklo_pd(w, w);
+        const reg wi = _mm512_unpackhi_pd(w, w);
+        return _mm512_fmaddsub_pd(a, wr, _mm512_mul_pd(swap(a), wi));
+    }
+    static reg rotation(int sign) {
+        const double s = sign;
+        return _mm512_set_pd(s, -s, s, -s, s, -s, s, -s);
+    }
+    static reg rot(reg a, reg r) { return _mm512_mul_pd(swap(a), r); }
+    static reg swap(reg a) { return _mm512_shuffle_pd(a, a, 0x55); }
+};
+
+// Eight complex floats per register; short stages drop to AVX2
+template <>
+struct avx512_vec<float> {
+    using value_type = float;
+    using narrow = avx2_vec<float>;
+    static constexpr int lanes = 8;
+    using reg = __m512;
+
+    static reg load(const float *p) { return _mm512_loadu_ps(p); }
+    static void store(float *p, reg a) { _mm512_storeu_ps(p, a); }
+    static reg add(reg a, reg b) { return _mm512_add_ps(a, b); }
+    static reg sub(reg a, reg b) { return _mm512_sub_ps(a, b); }
+    static reg cmul(reg a, reg w) {
+        const reg wr = _mm512_shuffle_ps(w, w, 0xA0);
+        const reg wi = _mm512_shuffle_ps(w, w, 0xF5);
+        return _mm512_fmaddsub_ps(a, wr, _mm512_mul_ps(swap(a), wi));
+    }
+    static reg rotation(int sign) {
+        const float s = sign;
+        return _mm512_set_ps(s, -s, s, -s, s, -s, s, -s, s, -s, s, -s, s, -s, s, -s);
+    }
+    static reg rot(reg a, reg r) { return _mm512_mul_ps(swap(a), r); }
+    static reg swap(reg a) { return _mm512_shuffle_ps(a, a, 0xB1); }
+};
+
+} // namespace
+
+template <typename T>
+const kernels<T> &avx512() {
+    static constexpr kernels<T> k = make_kernels<avx512_vec<T>>("avx512");
+    return k;
+}
+
+template const kernels<float> &avx512<float>();
+template const kernels<double> &avx512<double>();
+
+} // namespace keyq::simd
@@ -0,0 +1,73 @@
+#include "butterflies.h"
+
+#include <arm_neon.h>
+
+namespace keyq::simd {
+namespace {
+
+template <typename T>
+struct neon_vec;
+
+// One complex double per register
+template <>
+struct neon_vec<double> {
+    using value_type = double;
+    static constexpr int lanes = 1;
+    using reg = float64x2_t;
+
+    static reg load(const double *p) { return vld1q_f64(p); }
+    static void store(double *p, reg a) { vst1q_f64(p, a); }
+    static reg add(reg a, reg b) { return vaddq_f64(a, b); }
+    static reg sub(reg a, reg b) { return vsubq_f64(a, b); }
+    static reg cmul(reg a, reg w) {
+        const reg wr = vdupq_laneq_f64(w, 0);
+        const reg wi = vdupq_laneq_f64(w, 1);
+        const double sign[2] = {-1.0, 1.0};
+        const reg t = vmulq_f64(vmulq_f64(vextq_f64(a, a, 1), wi), vld1q_f64(sign));
+        return vfmaq_f64(t, a, wr);
+    }
+    static reg rotation(int sign) {
+        const double r[2] = {-1.0 * sign, 1.0 * sign};
+        return vld1q_f64(r);
+    }
+    static reg rot(reg a, reg r) { return vmulq_f64(vextq_f64(a, a, 1), r); }
+};
+
+// Two complex floats per register
+template <>
+struct neon_vec<float> {
+    using value_type = float;
+    static constexpr int lanes = 2;
+    using reg = float32x4_t;
+
+    static reg load(const float *p) { return vld1q_f32(p); }
+    static void store(float *p, reg a) { vst1q_f32(p, a); }
+    static reg add(reg a, reg b) { return vaddq_f32(a, b); }
+    static reg sub(reg a, reg b) { return vsubq_f32(a, b); }
+    static reg cmul(reg a, reg w) {
+        const reg wr = vtrn1q_f32(w, w);
+        const reg wi = vtrn2q_f32(w, w);
+        const float sign[4] = {-1.f, 1.f, -1.f, 1.f};
+        const reg t = vmulq_f32(vmulq_f32(vrev64q_f32(a), wi), vld1q_f32(sign));
+        return vfmaq_f32(t, a, wr);
+    }
+    static reg rotation(int sign) {
+        const float s = sign;
+        const float r[4] = {-s, s, -s, s};
+        return vld1q_f32(r);
+    }
+    static reg rot(reg a, reg r) { return vmulq_f32(vrev64q_f32(a), r); }
+};
+
+} // namespace
+
+template <typename T>
+const kernels<T> &neon() {
+    static constexpr kernels<T> k = make_kernels<neon_vec<T>>("neon");
+    return k;
+}
+
+template const kernels<float> &neon<float>();
+template const kernels<double> &neon<double>();
+
+} // namespace keyq::simd
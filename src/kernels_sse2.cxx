@@ -0,0 +1,68 @@
+#include "butterflies.h"
+
+#include <emmintrin.h>
+
+namespace keyq::simd {
+namespace {
+
+template <typename T>
+struct sse2_vec;
+
+// One complex double per register; SSE2 has no addsub, so the sign goes in with an xor
+template <>
+struct sse2_vec<double> {
+    using value_type = double;
+    static constexpr int lanes = 1;
+    using reg = __m128d;
+
+    static reg load(const double *p) { return _mm_loadu_pd(p); }
+    static void store(double *p, reg a) { _mm_storeu_pd(p, a); }
+    static reg add(reg a, reg b) { return _mm_add_pd(a, b); }
+    static reg sub(reg a, reg b) { return _mm_sub_pd(a, b); }
+    static reg cmul(reg a, reg w) {
+        const reg wr = _mm_unpacklo_pd(w, w);
+        const reg wi = _mm_unpackhi_pd(w, w);
+        const reg t = _mm_mul_pd(_mm_shuffle_pd(a, a, 1), wi);
+        return _mm_add_pd(_mm_mul_pd(a, wr), _mm_xor_pd(t, _mm_set_pd(0.0, -0.0)));
+    }
+    static reg rotation(int sign) { return _mm_set_pd(1.0 * sign, -1.0 * sign); }
+    static reg rot(reg a, reg r) { return _mm_mul_pd(_mm_shuffle_pd(a, a, 1), r); }
+};
+
+// Two complex floats per register
+template <>
+struct sse2_vec<float> {
+    using value_type = float;
+    static constexpr int lanes = 2;
+    using reg = __m128;
+
+    static reg load(const float *p) { return _mm_loadu_ps(p); }
+    static void store(float *p, reg a) { _mm_storeu_ps(p, a); }
+    static reg add(reg a, reg b) { return _mm_add_ps(a, b); }
+    static reg sub(reg a, reg b) { return _mm_sub_ps(a, b); }
+    static reg cmul(reg a, reg w) {
+        const reg wr = _mm_shuffle_ps(w, w, _MM_SHUFFLE(2, 2, 0, 0));
+        const reg wi = _mm_shuffle_ps(w, w, _MM_SHUFFLE(3, 3, 1, 1));
+        const reg t = _mm_mul_ps(swap(a), wi);
+        return _mm_add_ps(_mm_mul_ps(a, wr), _mm_xor_ps(t, _mm_set_ps(0.f, -0.f, 0.f, -0.f)));
+    }
+    static reg rotation(int sign) {
+        const float s = sign;
+        return _mm_set_ps(s, -s, s, -s);
+    }
+    static reg rot(reg a, reg r) { return _mm_mul_ps(swap(a), r); }
+    static reg swap(reg a) { return _mm_shuffle_ps(a, a, _MM_SHUFFLE(2, 3, 0, 1)); }
+};
+
+} // namespace
+
+template <typename T>
+const kernels<T> &sse2() {
+    static constexpr kernels<T> k = make_kernels<sse2_vec<T>>("sse2");
+    return k;
+}
+
+template const kernels<float> &sse2<float>();
+template const kernels<double> &sse2<double>();
+
+} // namespace keyq::simd
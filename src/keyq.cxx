@@ -1,383 +1,736 @@
 #include "../include/keyq.h"
 
-#include <cmath>
+#include "dft.h"
+#include "instrument.h"
+#include "memory.h"
+#include "out_of_core.h"
+#include "planner.h"
+#include "r2r.h"
+#include "thread_pool.h"
+
+#include <climits>
+#include <complex>
 #include <cstdlib>
 #include <cstring>
-#include <numbers>
-#include <print>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Internal plan structure, shared by the double and float front ends
+template <typename T>
+struct plan {
+    using value_type = T;
+    using layout = typename keyq::batch<T>::layout;
+
+    // The engine's tables, together; declared first so it outlives them
+    keyq::memory::arena arena;
 
-// Internal plan structure
-struct fftw_plan_s {
     int n;
     int rank;
+    int howmany;
     int sign;
+    int threads; // fixed at plan time, as in FFTW
     unsigned flags;
-    fftw_complex *in;
-    fftw_complex *out;
+    T *in; // interleaved complex, or real for the real side of r2c/c2r
+    T *out;
     bool is_r2c;
     bool is_c2r;
-};
 
-// Global state
-static int threads_initialized = 0;
-static int nthreads = 1;
-static double time_limit = -1.0;
+    std::vector<int> dims; // row-major extents, last one contiguous
 
-extern "C" {
+    // Transform engine chosen at plan time (radix-2, mixed radix or Bluestein per axis),
+    // wrapped in the batch's array layout
+    std::unique_ptr<keyq::batch<T>> batch;
 
-// Core planning functions
-fftw_plan fftw_plan_dft_1d(int n, fftw_complex *in, fftw_complex *out, int sign, unsigned flags) {
-    std::print("fftw_plan_dft_1d: n={}, sign={}, flags={}\n", n, sign, flags);
+    // Or real-to-real transforms, one kind per axis, in the same layouts
+    std::unique_ptr<keyq::r2r_batch<T>> r2r;
 
-    fftw_plan plan = static_cast<fftw_plan>(malloc(sizeof(fftw_plan_s)));
-    if (!plan)
-        return nullptr;
+    // Or, for a file plan, the out-of-core transform between the two files
+    std::unique_ptr<keyq::out_of_core<T>> file;
 
-    plan->n = n;
-    plan->rank = 1;
-    plan->sign = sign;
-    plan->flags = flags;
-    plan->in = in;
-    plan->out = out;
-    plan->is_r2c = false;
-    plan->is_c2r = false;
+    // Execution counters, updated by const execution
+    mutable keyq::instrument::counters stats;
+};
 
-    return plan;
+struct fftw_plan_s : plan<double> {};
+struct fftwf_plan_s : plan<float> {};
+
+// Global state
+static int threads_initialized = 0;
+static int nthreads = 1;
+
+static constexpr const char *kind_names[] = {"c2c", "r2c", "c2r"};
+
+// FFTW_ESTIMATE plans from wisdom or heuristics; everything else measures, harder for
+// PATIENT and EXHAUSTIVE. Measuring times private buffers, so in and out are never touched.
+static keyq::rigor effort(unsigned flags) {
+    if (flags & FFTW_EXHAUSTIVE)
+        return keyq::rigor::exhaustive;
+    if (flags & FFTW_PATIENT)
+        return keyq::rigor::patient;
+    if (flags & FFTW_ESTIMATE)
+        return keyq::rigor::estimate;
+    return keyq::rigor::measure;
 }
 
-fftw_plan fftw_plan_dft_2d(int n0, int n1, fftw_complex *in, fftw_complex *out, int sign,
-                           unsigned flags) {
-    std::print("fftw_plan_dft_2d: n0={}, n1={}, sign={}, flags={}\n", n0, n1, sign, flags);
+// Allocate a plan and build its transform engine; tables are precomputed here so execution
+// only does butterflies. Inverse transforms, c2r included, are normalised by 1/N as part of
+// the engine's output pass. Returns null if allocation fails or the shape isn't supported.
+template <typename P, typename T = typename P::value_type>
+static P *make_plan(keyq::kind kind, std::vector<int> dims, int howmany,
+                    const typename P::layout &in_layout, const typename P::layout &out_layout,
+                    int sign, unsigned flags, void *in, void *out) {
+    if (dims.empty() || (kind != keyq::kind::c2c && dims.size() != 1))
+        return nullptr;
+    for (const int n : dims)
+        if (n < 1)
+            return nullptr;
 
-    fftw_plan plan = static_cast<fftw_plan>(malloc(sizeof(fftw_plan_s)));
+    P *plan = keyq::memory::create<P>();
     if (!plan)
         return nullptr;
 
-    plan->n = n0 * n1;
-    plan->rank = 2;
+    int total_n = 1;
+    for (const int n : dims)
+        total_n *= n;
+
+    plan->n = total_n;
+    plan->rank = static_cast<int>(dims.size());
+    plan->howmany = howmany;
+    plan->dims = std::move(dims);
     plan->sign = sign;
     plan->flags = flags;
-    plan->in = in;
-    plan->out = out;
-    plan->is_r2c = false;
-    plan->is_c2r = false;
+    plan->in = static_cast<T *>(in);
+    plan->out = static_cast<T *>(out);
+    plan->is_r2c = kind == keyq::kind::r2c;
+    plan->is_c2r = kind == keyq::kind::c2r;
+    plan->threads = threads_initialized ? nthreads : 1;
+
+    const T scale = sign == FFTW_BACKWARD ? T(1) / total_n : T(1);
+    try {
+        const keyq::memory::scope tables(&plan->arena);
+        plan->batch = std::make_unique<keyq::batch<T>>(kind, plan->dims, howmany, in_layout,
+                                                       out_layout, sign, scale, plan->threads,
+                                                       effort(flags));
+    } catch (const std::exception &e) {
+        keyq::instrument::trace("plan: {} {}: {}", kind_names[static_cast<int>(kind)], total_n,
+                                e.what());
+        keyq::memory::destroy(plan);
+        return nullptr;
+    }
 
+    if constexpr (keyq::instrument::compiled) {
+        // Reals in each array per transform; the complex side of a real one holds n/2+1 values
+        const size_t complex_side = 2 * static_cast<size_t>(
+                                            kind == keyq::kind::c2c ? total_n : total_n / 2 + 1);
+        const size_t other_side = kind == keyq::kind::c2c ? complex_side : total_n;
+        plan->stats.algorithm = plan->batch->describe();
+        plan->stats.bytes_per_run = (complex_side + other_side) * sizeof(T) * howmany;
+        keyq::instrument::trace("plan: {} {} {} x {} sign {} flags {}: {}",
+                                sizeof(T) == sizeof(float) ? "float" : "double",
+                                kind_names[static_cast<int>(kind)], total_n, howmany, sign, flags,
+                                plan->stats.algorithm);
+    }
     return plan;
 }
 
-fftw_plan fftw_plan_dft_3d(int n0, int n1, int n2, fftw_complex *in, fftw_complex *out, int sign,
-                           unsigned flags) {
-    std::print("fftw_plan_dft_3d: n0={}, n1={}, n2={}, sign={}, flags={}\n", n0, n1, n2, sign,
-               flags);
+// Single contiguous transform
+template <typename P>
+static P *make_plan(keyq::kind kind, std::vector<int> dims, int sign, unsigned flags,
+                    void *in, void *out) {
+    return make_plan<P>(kind, std::move(dims), 1, {}, {}, sign, flags, in, out);
+}
 
-    fftw_plan plan = static_cast<fftw_plan>(malloc(sizeof(fftw_plan_s)));
-    if (!plan)
+// Advanced interface: null embeds mean the transform's own extents
+template <typename P>
+static P *make_many(keyq::kind kind, int rank, const int *n, int howmany, void *in,
+                    const int *inembed, int istride, int idist, void *out, const int *onembed,
+                    int ostride, int odist, int sign, unsigned flags) {
+    if (rank < 1 || howmany < 0)
         return nullptr;
 
-    plan->n = n0 * n1 * n2;
-    plan->rank = 3;
-    plan->sign = sign;
-    plan->flags = flags;
-    plan->in = in;
-    plan->out = out;
-    plan->is_r2c = false;
-    plan->is_c2r = false;
+    typename P::layout in_layout{{}, istride, idist};
+    typename P::layout out_layout{{}, ostride, odist};
+    if (inembed)
+        in_layout.embed.assign(inembed, inembed + rank);
+    if (onembed)
+        out_layout.embed.assign(onembed, onembed + rank);
 
-    return plan;
+    return make_plan<P>(kind, {n, n + rank}, howmany, in_layout, out_layout, sign, flags, in,
+                        out);
 }
 
-fftw_plan fftw_plan_dft(int rank, const int *n, fftw_complex *in, fftw_complex *out, int sign,
-                        unsigned flags) {
-    std::print("fftw_plan_dft: rank={}, sign={}, flags={}\n", rank, sign, flags);
-
-    fftw_plan plan = static_cast<fftw_plan>(malloc(sizeof(fftw_plan_s)));
+// Real-to-real plan with a kind per dimension; null if a size doesn't suit its kind. Unlike
+// make_plan's, nothing is normalised, as in FFTW.
+template <typename P, typename T = typename P::value_type>
+static P *make_r2r(std::vector<int> dims, const fftw_r2r_kind *kinds, int howmany,
+                   const typename P::layout &in_layout, const typename P::layout &out_layout,
+                   unsigned flags, void *in, void *out) {
+    if (dims.empty() || !kinds || howmany < 0)
+        return nullptr;
+    for (size_t k = 0; k < dims.size(); ++k)
+        if (kinds[k] < FFTW_R2HC || kinds[k] > FFTW_RODFT11)
+            return nullptr;
+    P *plan = keyq::memory::create<P>();
     if (!plan)
         return nullptr;
 
     int total_n = 1;
-    for (int i = 0; i < rank; ++i) {
-        total_n *= n[i];
-    }
+    for (const int n : dims)
+        total_n *= n;
 
     plan->n = total_n;
-    plan->rank = rank;
-    plan->sign = sign;
+    plan->rank = static_cast<int>(dims.size());
+    plan->howmany = howmany;
+    plan->dims = std::move(dims);
+    plan->sign = 0;
     plan->flags = flags;
-    plan->in = in;
-    plan->out = out;
-    plan->is_r2c = false;
-    plan->is_c2r = false;
+    plan->in = static_cast<T *>(in);
+    plan->out = static_cast<T *>(out);
+    plan->threads = threads_initialized ? nthreads : 1;
+
+    std::vector<keyq::r2r_kind> axis_kinds;
+    for (int k = 0; k < plan->rank; ++k)
+        axis_kinds.push_back(static_cast<keyq::r2r_kind>(kinds[k]));
+    try {
+        const keyq::memory::scope tables(&plan->arena);
+        plan->r2r = std::make_unique<keyq::r2r_batch<T>>(plan->dims, axis_kinds, howmany,
+                                                         in_layout, out_layout, plan->threads,
+                                                         effort(flags));
+    } catch (const std::exception &e) {
+        keyq::instrument::trace("plan: r2r {}: {}", total_n, e.what());
+        keyq::memory::destroy(plan);
+        return nullptr;
+    }
 
+    if constexpr (keyq::instrument::compiled) {
+        plan->stats.algorithm = plan->r2r->describe();
+        plan->stats.bytes_per_run = 2 * static_cast<size_t>(total_n) * sizeof(T) * howmany;
+        keyq::instrument::trace("plan: {} r2r {} x {} flags {}: {}",
+                                sizeof(T) == sizeof(float) ? "float" : "double", total_n,
+                                howmany, flags, plan->stats.algorithm);
+    }
     return plan;
 }
 
-// Real-to-complex transforms
-fftw_plan fftw_plan_dft_r2c_1d(int n, double *in, fftw_complex *out, unsigned flags) {
-    std::print("fftw_plan_dft_r2c_1d: n={}, flags={}\n", n, flags);
-
-    fftw_plan plan = static_cast<fftw_plan>(malloc(sizeof(fftw_plan_s)));
-    if (!plan)
+// Advanced interface for r2r, laid out as make_many
+template <typename P>
+static P *make_many_r2r(int rank, const int *n, int howmany, void *in, const int *inembed,
+                        int istride, int idist, void *out, const int *onembed, int ostride,
+                        int odist, const fftw_r2r_kind *kinds, unsigned flags) {
+    if (rank < 1)
         return nullptr;
 
-    plan->n = n;
-    plan->rank = 1;
-    plan->sign = FFTW_FORWARD;
-    plan->flags = flags;
-    plan->in = reinterpret_cast<fftw_complex *>(in);
-    plan->out = out;
-    plan->is_r2c = true;
-    plan->is_c2r = false;
+    typename P::layout in_layout{{}, istride, idist};
+    typename P::layout out_layout{{}, ostride, odist};
+    if (inembed)
+        in_layout.embed.assign(inembed, inembed + rank);
+    if (onembed)
+        out_layout.embed.assign(onembed, onembed + rank);
 
-    return plan;
+    return make_r2r<P>({n, n + rank}, kinds, howmany, in_layout, out_layout, flags, in, out);
 }
 
-fftw_plan fftw_plan_dft_c2r_1d(int n, fftw_complex *in, double *out, unsigned flags) {
-    std::print("fftw_plan_dft_c2r_1d: n={}, flags={}\n", n, flags);
-
-    fftw_plan plan = static_cast<fftw_plan>(malloc(sizeof(fftw_plan_s)));
+// Out-of-core plan between two files; null, traced, if they can't be opened or mapped or n
+// can't be split to fit the memory
+template <typename P, typename T = typename P::value_type>
+static P *make_file_plan(long long n, const char *in, const char *out, int sign,
+                         unsigned flags, size_t memory) {
+    if (!in || !out)
+        return nullptr;
+    P *plan = keyq::memory::create<P>();
     if (!plan)
         return nullptr;
 
-    plan->n = n;
+    plan->n = n <= INT_MAX ? static_cast<int>(n) : 0;
     plan->rank = 1;
-    plan->sign = FFTW_BACKWARD;
+    plan->howmany = 1;
+    plan->sign = sign;
     plan->flags = flags;
-    plan->in = in;
-    plan->out = reinterpret_cast<fftw_complex *>(out);
-    plan->is_r2c = false;
-    plan->is_c2r = true;
+    plan->threads = threads_initialized ? nthreads : 1;
+
+    const T scale = sign == FFTW_BACKWARD ? static_cast<T>(1.0 / static_cast<double>(n)) : T(1);
+    try {
+        const keyq::memory::scope tables(&plan->arena);
+        plan->file = std::make_unique<keyq::out_of_core<T>>(n, in, out, sign, memory, scale,
+                                                            plan->threads, effort(flags));
+    } catch (const std::exception &e) {
+        keyq::instrument::trace("plan: file {} -> {}: {}", in, out, e.what());
+        keyq::memory::destroy(plan);
+        return nullptr;
+    }
 
+    if constexpr (keyq::instrument::compiled) {
+        plan->stats.algorithm = plan->file->describe();
+        plan->stats.bytes_per_run = 2 * static_cast<size_t>(n) * sizeof(std::complex<T>);
+        keyq::instrument::trace("plan: {} file {} -> {} {} sign {} flags {}: {}",
+                                sizeof(T) == sizeof(float) ? "float" : "double", in, out, n,
+                                sign, flags, plan->stats.algorithm);
+    }
     return plan;
 }
 
-// Check if n is a power of 2
-static bool is_power_of_2(int n) {
-    return n > 0 && (n & (n - 1)) == 0;
-}
-
-// Bit-reverse permutation
-static void bit_reverse(fftw_complex *data, int n) {
-    int j = 0;
-    for (int i = 1; i < n; ++i) {
-        int bit = n >> 1;
-        while (j & bit) {
-            j ^= bit;
-            bit >>= 1;
-        }
-        j ^= bit;
-        if (i < j) {
-            std::swap(data[i][0], data[j][0]);
-            std::swap(data[i][1], data[j][1]);
-        }
+template <typename T>
+static int plan_stats(const plan<T> *p, keyq_stats *stats) {
+    if (!stats)
+        return 0;
+    *stats = {};
+    if constexpr (keyq::instrument::compiled) {
+        if (!p)
+            return 0;
+        const auto &c = p->stats;
+        stats->executions = c.executions.load();
+        stats->total_ns = c.total_ns.load();
+        stats->min_ns = stats->executions ? c.min_ns.load() : 0;
+        stats->max_ns = c.max_ns.load();
+        stats->bytes = stats->executions * c.bytes_per_run;
+        stats->algorithm = c.algorithm.c_str();
+        return 1;
     }
+    return 0;
 }
 
-// Cooley-Tukey FFT implementation (O(N log N))
-static void cooley_tukey_fft(fftw_complex *data, int n, int sign) {
-    if (n <= 1) return;
+// New-array execution; file plans have no arrays and ignore it
+template <typename T>
+static void execute(const plan<T> *p, const T *in, T *out) {
+    if (p->r2r) {
+        const keyq::instrument::timed timing(p->stats);
+        p->r2r->execute(in, out, keyq::thread_scratch<T>(p->r2r->scratch_size()));
+        return;
+    }
+    if (!p->batch)
+        return;
+    const keyq::instrument::timed timing(p->stats);
+    p->batch->execute(in, out, keyq::thread_scratch<T>(p->batch->scratch_size()));
+}
 
-    // Bit-reverse the input
-    bit_reverse(data, n);
+// The arrays or files given at plan time
+template <typename T>
+static void execute(const plan<T> *p) {
+    if (p->file) {
+        const keyq::instrument::timed timing(p->stats);
+        p->file->execute();
+        return;
+    }
+    execute<T>(p, p->in, p->out);
+}
 
-    // Cooley-Tukey FFT
-    const double direction = (sign == FFTW_FORWARD) ? -1.0 : 1.0;
+extern "C" {
 
-    for (int len = 2; len <= n; len <<= 1) {
-        const double angle = direction * 2.0 * std::numbers::pi / len;
-        const double wlen_r = std::cos(angle);
-        const double wlen_i = std::sin(angle);
+// Core planning functions
+fftw_plan fftw_plan_dft_1d(int n, fftw_complex *in, fftw_complex *out, int sign, unsigned flags) {
+    return make_plan<fftw_plan_s>(keyq::kind::c2c, {n}, sign, flags, in, out);
+}
 
-        for (int i = 0; i < n; i += len) {
-            double w_r = 1.0;
-            double w_i = 0.0;
+fftw_plan fftw_plan_dft_2d(int n0, int n1, fftw_complex *in, fftw_complex *out, int sign,
+                           unsigned flags) {
+    return make_plan<fftw_plan_s>(keyq::kind::c2c, {n0, n1}, sign, flags, in, out);
+}
 
-            for (int j = 0; j < len / 2; ++j) {
-                const int u = i + j;
-                const int v = i + j + len / 2;
+fftw_plan fftw_plan_dft_3d(int n0, int n1, int n2, fftw_complex *in, fftw_complex *out, int sign,
+                           unsigned flags) {
+    return make_plan<fftw_plan_s>(keyq::kind::c2c, {n0, n1, n2}, sign, flags, in, out);
+}
 
-                const double u_r = data[u][0];
-                const double u_i = data[u][1];
-                const double v_r = data[v][0];
-                const double v_i = data[v][1];
+fftw_plan fftw_plan_dft(int rank, const int *n, fftw_complex *in, fftw_complex *out, int sign,
+                        unsigned flags) {
+    if (rank < 1)
+        return nullptr;
+    return make_plan<fftw_plan_s>(keyq::kind::c2c, {n, n + rank}, sign, flags, in, out);
+}
 
-                const double temp_r = w_r * v_r - w_i * v_i;
-                const double temp_i = w_r * v_i + w_i * v_r;
+// Real-to-complex transforms
+fftw_plan fftw_plan_dft_r2c_1d(int n, double *in, fftw_complex *out, unsigned flags) {
+    return make_plan<fftw_plan_s>(keyq::kind::r2c, {n}, FFTW_FORWARD, flags, in, out);
+}
 
-                data[u][0] = u_r + temp_r;
-                data[u][1] = u_i + temp_i;
-                data[v][0] = u_r - temp_r;
-                data[v][1] = u_i - temp_i;
+fftw_plan fftw_plan_dft_c2r_1d(int n, fftw_complex *in, double *out, unsigned flags) {
+    return make_plan<fftw_plan_s>(keyq::kind::c2r, {n}, FFTW_BACKWARD, flags, in, out);
+}
 
-                const double new_w_r = w_r * wlen_r - w_i * wlen_i;
-                const double new_w_i = w_r * wlen_i + w_i * wlen_r;
-                w_r = new_w_r;
-                w_i = new_w_i;
-            }
-        }
-    }
+// Advanced interface: howmany transforms of one shape over strided, embedded arrays
+fftw_plan fftw_plan_many_dft(int rank, const int *n, int howmany, fftw_complex *in,
+                             const int *inembed, int istride, int idist, fftw_complex *out,
+                             const int *onembed, int ostride, int odist, int sign,
+                             unsigned flags) {
+    return make_many<fftw_plan_s>(keyq::kind::c2c, rank, n, howmany, in, inembed, istride, idist,
+                                  out, onembed, ostride, odist, sign, flags);
+}
 
-    // For inverse transform, divide by N
-    if (sign == FFTW_BACKWARD) {
-        for (int i = 0; i < n; ++i) {
-            data[i][0] /= n;
-            data[i][1] /= n;
-        }
-    }
+fftw_plan fftw_plan_many_dft_r2c(int rank, const int *n, int howmany, double *in,
+                                 const int *inembed, int istride, int idist, fftw_complex *out,
+                                 const int *onembed, int ostride, int odist, unsigned flags) {
+    return make_many<fftw_plan_s>(keyq::kind::r2c, rank, n, howmany, in, inembed, istride, idist,
+                                  out, onembed, ostride, odist, FFTW_FORWARD, flags);
 }
 
-// Fallback DFT for non-power-of-2 sizes (O(N²) - slow but correct)
-static void basic_dft(const fftw_complex *input, fftw_complex *output, int n, int sign) {
-    const double direction = (sign == FFTW_FORWARD) ? -1.0 : 1.0;
+fftw_plan fftw_plan_many_dft_c2r(int rank, const int *n, int howmany, fftw_complex *in,
+                                 const int *inembed, int istride, int idist, double *out,
+                                 const int *onembed, int ostride, int odist, unsigned flags) {
+    return make_many<fftw_plan_s>(keyq::kind::c2r, rank, n, howmany, in, inembed, istride, idist,
+                                  out, onembed, ostride, odist, FFTW_BACKWARD, flags);
+}
 
-    for (int k = 0; k < n; ++k) {
-        output[k][0] = 0.0; // Real part
-        output[k][1] = 0.0; // Imaginary part
+// Real-to-real transforms
+fftw_plan fftw_plan_r2r_1d(int n, double *in, double *out, fftw_r2r_kind kind, unsigned flags) {
+    return make_r2r<fftw_plan_s>({n}, &kind, 1, {}, {}, flags, in, out);
+}
 
-        for (int j = 0; j < n; ++j) {
-            const double angle = direction * 2.0 * std::numbers::pi * k * j / n;
-            const double cos_val = std::cos(angle);
-            const double sin_val = std::sin(angle);
+fftw_plan fftw_plan_r2r_2d(int n0, int n1, double *in, double *out, fftw_r2r_kind kind0,
+                           fftw_r2r_kind kind1, unsigned flags) {
+    const fftw_r2r_kind kinds[] = {kind0, kind1};
+    return make_r2r<fftw_plan_s>({n0, n1}, kinds, 1, {}, {}, flags, in, out);
+}
 
-            // Complex multiplication: (a + bi) * (c + di) = (ac - bd) + (ad + bc)i
-            const double real_part = input[j][0] * cos_val - input[j][1] * sin_val;
-            const double imag_part = input[j][0] * sin_val + input[j][1] * cos_val;
+fftw_plan fftw_plan_r2r_3d(int n0, int n1, int n2, double *in, double *out, fftw_r2r_kind kind0,
+                           fftw_r2r_kind kind1, fftw_r2r_kind kind2, unsigned flags) {
+    const fftw_r2r_kind kinds[] = {kind0, kind1, kind2};
+    return make_r2r<fftw_plan_s>({n0, n1, n2}, kinds, 1, {}, {}, flags, in, out);
+}
 
-            output[k][0] += real_part;
-            output[k][1] += imag_part;
-        }
+fftw_plan fftw_plan_r2r(int rank, const int *n, double *in, double *out,
+                        const fftw_r2r_kind *kind, unsigned flags) {
+    if (rank < 1)
+        return nullptr;
+    return make_r2r<fftw_plan_s>({n, n + rank}, kind, 1, {}, {}, flags, in, out);
+}
 
-        // For inverse transform, divide by N
-        if (sign == FFTW_BACKWARD) {
-            output[k][0] /= n;
-            output[k][1] /= n;
-        }
-    }
+fftw_plan fftw_plan_many_r2r(int rank, const int *n, int howmany, double *in, const int *inembed,
+                             int istride, int idist, double *out, const int *onembed,
+                             int ostride, int odist, const fftw_r2r_kind *kind, unsigned flags) {
+    return make_many_r2r<fftw_plan_s>(rank, n, howmany, in, inembed, istride, idist, out,
+                                      onembed, ostride, odist, kind, flags);
 }
 
 // Execution functions
 void fftw_execute(const fftw_plan p) {
-    if (!p)
-        return;
-    if (p->is_r2c || p->is_c2r) {
-        std::print("Real-to-complex transforms not yet implemented\n");
-        return;
-    }
-
-    // Use fast FFT for power-of-2 sizes, fallback to DFT otherwise
-    if (is_power_of_2(p->n)) {
-        // Copy input to output for in-place FFT
-        if (p->in != p->out) {
-            memcpy(p->out, p->in, p->n * sizeof(fftw_complex));
-        }
-        cooley_tukey_fft(p->out, p->n, p->sign);
-    } else {
-        basic_dft(p->in, p->out, p->n, p->sign);
-    }
+    if (p)
+        execute<double>(p);
 }
 
 void fftw_execute_dft(const fftw_plan p, fftw_complex *in, fftw_complex *out) {
     if (!p)
         return;
-    std::print("fftw_execute_dft: executing with new arrays\n");
 
-    // TODO: Implement actual FFT computation with new arrays
-    if (in != out) {
-        memcpy(out, in, p->n * sizeof(fftw_complex));
-    }
+    if (!p->is_r2c && !p->is_c2r && !p->r2r)
+        execute<double>(p, reinterpret_cast<double *>(in), reinterpret_cast<double *>(out));
 }
 
 void fftw_execute_dft_r2c(const fftw_plan p, double *in, fftw_complex *out) {
     if (!p)
         return;
-    std::print("fftw_execute_dft_r2c: executing real-to-complex\n");
-
-    // TODO: Implement real-to-complex FFT
-    for (int i = 0; i < p->n / 2 + 1; ++i) {
-        if (i < p->n) {
-            out[i][0] = in[i];
-            out[i][1] = 0.0;
-        }
-    }
+    if (p->is_r2c)
+        execute<double>(p, in, reinterpret_cast<double *>(out));
 }
 
 void fftw_execute_dft_c2r(const fftw_plan p, fftw_complex *in, double *out) {
     if (!p)
         return;
-    std::print("fftw_execute_dft_c2r: executing complex-to-real\n");
+    if (p->is_c2r)
+        execute<double>(p, reinterpret_cast<double *>(in), out);
+}
 
-    // TODO: Implement complex-to-real FFT
-    for (int i = 0; i < p->n; ++i) {
-        out[i] = in[i][0];
-    }
+void fftw_execute_r2r(const fftw_plan p, double *in, double *out) {
+    if (p && p->r2r)
+        execute<double>(p, in, out);
 }
 
 // Memory management
 void *fftw_malloc(size_t n) {
-    std::print("fftw_malloc: allocating {} bytes\n", n);
-    return aligned_alloc(32, n); // 32-byte alignment for SIMD
+    keyq::instrument::trace("fftw_malloc: allocating {} bytes", n);
+    return keyq::memory::allocate(n);
 }
 
 void fftw_free(void *p) {
     if (p) {
-        std::print("fftw_free: freeing memory\n");
-        free(p);
+        keyq::instrument::trace("fftw_free: freeing memory");
+        keyq::memory::release(p);
     }
 }
 
 void fftw_destroy_plan(fftw_plan p) {
     if (p) {
-        std::print("fftw_destroy_plan: destroying plan\n");
-        free(p);
+        keyq::instrument::trace("fftw_destroy_plan: destroying plan");
+        keyq::memory::destroy(p);
     }
 }
 
-// Wisdom functions (stubs)
+// Wisdom: recipes found by measuring, shared by the double and float planners
 void fftw_forget_wisdom(void) {
-    std::print("fftw_forget_wisdom: clearing wisdom\n");
+    keyq::instrument::trace("fftw_forget_wisdom: clearing wisdom");
+    keyq::planner::forget();
 }
 
 int fftw_import_wisdom_from_filename(const char *filename) {
-    std::print("fftw_import_wisdom_from_filename: {}\n", filename ? filename : "null");
-    return 0; // Failed to import
+    keyq::instrument::trace("fftw_import_wisdom_from_filename: {}",
+                            filename ? filename : "null");
+    if (!filename)
+        return 0;
+    std::ifstream file(filename);
+    if (!file)
+        return 0;
+    const std::string text{std::istreambuf_iterator<char>(file), {}};
+    return keyq::planner::import_wisdom(text) ? 1 : 0;
 }
 
 int fftw_export_wisdom_to_filename(const char *filename) {
-    std::print("fftw_export_wisdom_to_filename: {}\n", filename ? filename : "null");
-    return 0; // Failed to export
+    keyq::instrument::trace("fftw_export_wisdom_to_filename: {}", filename ? filename : "null");
+    if (!filename)
+        return 0;
+    std::ofstream file(filename);
+    file << keyq::planner::export_wisdom();
+    return file.good() ? 1 : 0;
 }
 
+// The caller releases the string with free(), as with FFTW
 char *fftw_export_wisdom_to_string(void) {
-    std::print("fftw_export_wisdom_to_string: returning empty wisdom\n");
-    return nullptr;
+    keyq::instrument::trace("fftw_export_wisdom_to_string: exporting wisdom");
+    const std::string text = keyq::planner::export_wisdom();
+    char *copy = static_cast<char *>(malloc(text.size() + 1));
+    if (copy)
+        std::memcpy(copy, text.c_str(), text.size() + 1);
+    return copy;
 }
 
 int fftw_import_wisdom_from_string(const char *input_string) {
-    std::print("fftw_import_wisdom_from_string: {}\n", input_string ? "provided" : "null");
-    return 0; // Failed to import
+    keyq::instrument::trace("fftw_import_wisdom_from_string: {}",
+                            input_string ? "provided" : "null");
+    return input_string && keyq::planner::import_wisdom(input_string) ? 1 : 0;
 }
 
-// Planning time limit
+// Planning time limit, in seconds per measured size; negative for none
 void fftw_set_timelimit(double t) {
-    std::print("fftw_set_timelimit: setting limit to {} seconds\n", t);
-    time_limit = t;
+    keyq::instrument::trace("fftw_set_timelimit: setting limit to {} seconds", t);
+    keyq::planner::set_time_limit(t);
 }
 
 // Thread support
 int fftw_init_threads(void) {
-    std::print("fftw_init_threads: initializing thread support\n");
+    keyq::instrument::trace("fftw_init_threads: initializing thread support");
     threads_initialized = 1;
     return 1; // Success
 }
 
+// Plans made from now on use n threads, the caller plus n - 1 pool workers
 void fftw_plan_with_nthreads(int n) {
-    std::print("fftw_plan_with_nthreads: setting {} threads\n", n);
-    nthreads = n;
+    keyq::instrument::trace("fftw_plan_with_nthreads: setting {} threads", n);
+    nthreads = n < 1 ? 1 : n;
+    if (threads_initialized)
+        keyq::pool::resize(nthreads - 1);
 }
 
 void fftw_cleanup_threads(void) {
-    std::print("fftw_cleanup_threads: cleaning up thread support\n");
+    keyq::instrument::trace("fftw_cleanup_threads: cleaning up thread support");
+    keyq::pool::resize(0);
     threads_initialized = 0;
     nthreads = 1;
 }
 
+// Single-precision API: the same engine instantiated for float
+fftwf_plan fftwf_plan_dft_1d(int n, fftwf_complex *in, fftwf_complex *out, int sign,
+                             unsigned flags) {
+    return make_plan<fftwf_plan_s>(keyq::kind::c2c, {n}, sign, flags, in, out);
+}
+
+fftwf_plan fftwf_plan_dft_2d(int n0, int n1, fftwf_complex *in, fftwf_complex *out, int sign,
+                             unsigned flags) {
+    return make_plan<fftwf_plan_s>(keyq::kind::c2c, {n0, n1}, sign, flags, in, out);
+}
+
+fftwf_plan fftwf_plan_dft_3d(int n0, int n1, int n2, fftwf_complex *in, fftwf_complex *out,
+                             int sign, unsigned flags) {
+    return make_plan<fftwf_plan_s>(keyq::kind::c2c, {n0, n1, n2}, sign, flags, in, out);
+}
+
+fftwf_plan fftwf_plan_dft(int rank, const int *n, fftwf_complex *in, fftwf_complex *out,
+                          int sign, unsigned flags) {
+    if (rank < 1)
+        return nullptr;
+    return make_plan<fftwf_plan_s>(keyq::kind::c2c, {n, n + rank}, sign, flags, in, out);
+}
+
+fftwf_plan fftwf_plan_dft_r2c_1d(int n, float *in, fftwf_complex *out, unsigned flags) {
+    return make_plan<fftwf_plan_s>(keyq::kind::r2c, {n}, FFTW_FORWARD, flags, in, out);
+}
+
+fftwf_plan fftwf_plan_dft_c2r_1d(int n, fftwf_complex *in, float *out, unsigned flags) {
+    return make_plan<fftwf_plan_s>(keyq::kind::c2r, {n}, FFTW_BACKWARD, flags, in, out);
+}
+
+fftwf_plan fftwf_plan_many_dft(int rank, const int *n, int howmany, fftwf_complex *in,
+                               const int *inembed, int istride, int idist, fftwf_complex *out,
+                               const int *onembed, int ostride, int odist, int sign,
+                               unsigned flags) {
+    return make_many<fftwf_plan_s>(keyq::kind::c2c, rank, n, howmany, in, inembed, istride,
+                                   idist, out, onembed, ostride, odist, sign, flags);
+}
+
+fftwf_plan fftwf_plan_many_dft_r2c(int rank, const int *n, int howmany, float *in,
+                                   const int *inembed, int istride, int idist,
+                                   fftwf_complex *out, const int *onembed, int ostride,
+                                   int odist, unsigned flags) {
+    return make_many<fftwf_plan_s>(keyq::kind::r2c, rank, n, howmany, in, inembed, istride,
+                                   idist, out, onembed, ostride, odist, FFTW_FORWARD, flags);
+}
+
+fftwf_plan fftwf_plan_many_dft_c2r(int rank, const int *n, int howmany, fftwf_complex *in,
+                                   const int *inembed, int istride, int idist, float *out,
+                                   const int *onembed, int ostride, int odist, unsigned flags) {
+    return make_many<fftwf_plan_s>(keyq::kind::c2r, rank, n, howmany, in, inembed, istride,
+                                   idist, out, onembed, ostride, odist, FFTW_BACKWARD, flags);
+}
+
+fftwf_plan fftwf_plan_r2r_1d(int n, float *in, float *out, fftwf_r2r_kind kind, unsigned flags) {
+    return make_r2r<fftwf_plan_s>({n}, &kind, 1, {}, {}, flags, in, out);
+}
+
+fftwf_plan fftwf_plan_r2r_2d(int n0, int n1, float *in, float *out, fftwf_r2r_kind kind0,
+                             fftwf_r2r_kind kind1, unsigned flags) {
+    const fftwf_r2r_kind kinds[] = {kind0, kind1};
+    return make_r2r<fftwf_plan_s>({n0, n1}, kinds, 1, {}, {}, flags, in, out);
+}
+
+fftwf_plan fftwf_plan_r2r_3d(int n0, int n1, int n2, float *in, float *out,
+                             fftwf_r2r_kind kind0, fftwf_r2r_kind kind1, fftwf_r2r_kind kind2,
+                             unsigned flags) {
+    const fftwf_r2r_kind kinds[] = {kind0, kind1, kind2};
+    return make_r2r<fftwf_plan_s>({n0, n1, n2}, kinds, 1, {}, {}, flags, in, out);
+}
+
+fftwf_plan fftwf_plan_r2r(int rank, const int *n, float *in, float *out,
+                          const fftwf_r2r_kind *kind, unsigned flags) {
+    if (rank < 1)
+        return nullptr;
+    return make_r2r<fftwf_plan_s>({n, n + rank}, kind, 1, {}, {}, flags, in, out);
+}
+
+fftwf_plan fftwf_plan_many_r2r(int rank, const int *n, int howmany, float *in,
+                               const int *inembed, int istride, int idist, float *out,
+                               const int *onembed, int ostride, int odist,
+                               const fftwf_r2r_kind *kind, unsigned flags) {
+    return make_many_r2r<fftwf_plan_s>(rank, n, howmany, in, inembed, istride, idist, out,
+                                       onembed, ostride, odist, kind, flags);
+}
+
+void fftwf_execute(const fftwf_plan p) {
+    if (p)
+        execute<float>(p);
+}
+
+void fftwf_execute_dft(const fftwf_plan p, fftwf_complex *in, fftwf_complex *out) {
+    if (p && !p->is_r2c && !p->is_c2r && !p->r2r)
+        execute<float>(p, reinterpret_cast<float *>(in), reinterpret_cast<float *>(out));
+}
+
+void fftwf_execute_dft_r2c(const fftwf_plan p, float *in, fftwf_complex *out) {
+    if (p && p->is_r2c)
+        execute<float>(p, in, reinterpret_cast<float *>(out));
+}
+
+void fftwf_execute_dft_c2r(const fftwf_plan p, fftwf_complex *in, float *out) {
+    if (p && p->is_c2r)
+        execute<float>(p, reinterpret_cast<float *>(in), out);
+}
+
+void fftwf_execute_r2r(const fftwf_plan p, float *in, float *out) {
+    if (p && p->r2r)
+        execute<float>(p, in, out);
+}
+
+void *fftwf_malloc(size_t n) {
+    return fftw_malloc(n);
+}
+
+void fftwf_free(void *p) {
+    fftw_free(p);
+}
+
+void fftwf_destroy_plan(fftwf_plan p) {
+    if (p) {
+        keyq::instrument::trace("fftwf_destroy_plan: destroying plan");
+        keyq::memory::destroy(p);
+    }
+}
+
+void fftwf_forget_wisdom(void) {
+    fftw_forget_wisdom();
+}
+
+int fftwf_import_wisdom_from_filename(const char *filename) {
+    return fftw_import_wisdom_from_filename(filename);
+}
+
+int fftwf_export_wisdom_to_filename(const char *filename) {
+    return fftw_export_wisdom_to_filename(filename);
+}
+
+char *fftwf_export_wisdom_to_string(void) {
+    return fftw_export_wisdom_to_string();
+}
+
+int fftwf_import_wisdom_from_string(const char *input_string) {
+    return fftw_import_wisdom_from_string(input_string);
+}
+
+void fftwf_set_timelimit(double t) {
+    fftw_set_timelimit(t);
+}
+
+int fftwf_init_threads(void) {
+    return fftw_init_threads();
+}
+
+void fftwf_plan_with_nthreads(int n) {
+    fftw_plan_with_nthreads(n);
+}
+
+void fftwf_cleanup_threads(void) {
+    fftw_cleanup_threads();
+}
+
+// Instrumentation
+int keyq_enable_stats(int on) {
+    keyq::instrument::stats_enabled = keyq::instrument::compiled && on;
+    return keyq::instrument::compiled;
+}
+
+int keyq_enable_trace(int on) {
+    keyq::instrument::trace_enabled = keyq::instrument::compiled && on;
+    return keyq::instrument::compiled;
+}
+
+int keyq_enable_huge_pages(int on) {
+    return keyq::memory::use_huge_pages(on != 0) ? 1 : 0;
+}
+
+fftw_plan keyq_plan_dft_1d_file(long long n, const char *in_path, const char *out_path, int sign,
+                                unsigned flags, size_t memory) {
+    return make_file_plan<fftw_plan_s>(n, in_path, out_path, sign, flags, memory);
+}
+
+fftwf_plan keyqf_plan_dft_1d_file(long long n, const char *in_path, const char *out_path,
+                                  int sign, unsigned flags, size_t memory) {
+    return make_file_plan<fftwf_plan_s>(n, in_path, out_path, sign, flags, memory);
+}
+
+int keyq_plan_stats(const fftw_plan p, keyq_stats *stats) {
+    return plan_stats<double>(p, stats);
+}
+
+int keyqf_plan_stats(const fftwf_plan p, keyq_stats *stats) {
+    return plan_stats<float>(p, stats);
+}
+
+void keyq_reset_plan_stats(fftw_plan p) {
+    if (p)
+        p->stats.reset();
+}
+
+void keyqf_reset_plan_stats(fftwf_plan p) {
+    if (p)
+        p->stats.reset();
+}
+
 } // extern "C"
\ No newline at end of file
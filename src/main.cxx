@@ -3,8 +3,13 @@
 #include <print>
 
 #include "../include/keyq.h"
+#include "../include/sliding_dft.h"
+#include "../include/stft.h"
 #include "../include/test.h"
 
+#include <complex>
+#include <vector>
+
 int main() {
     std::print("KEYQ FFT\n");
     std::print("Creating an FFTW3-compatible API from scratch\n\n");
@@ -48,6 +53,38 @@ int main() {
     std::print("\n");
     keyq_print_spectrum(output, N, sample_rate, 10);
 
+    // Stream the same tone through the STFT in audio-sized blocks
+    std::print("\nStreaming STFT...\n");
+    keyq::stft<double> analyser({.frame_size = 256, .hop = 64, .window = keyq::window::hann});
+    std::vector<double> block(100);
+    int frames = 0;
+    int peak_bin = 0;
+    for (int start = 0; start < 4096; start += static_cast<int>(block.size())) {
+        for (size_t i = 0; i < block.size(); ++i)
+            block[i] = std::sin(2.0 * std::numbers::pi * frequency * (start + i) / sample_rate);
+        analyser.push(block.data(), block.size(), [&](std::span<const std::complex<double>> bins) {
+            ++frames;
+            peak_bin = 0;
+            for (size_t k = 1; k < bins.size(); ++k)
+                if (std::abs(bins[k]) > std::abs(bins[peak_bin]))
+                    peak_bin = static_cast<int>(k);
+        });
+    }
+    std::print("{} frames, last peak at {:.1f} Hz\n", frames,
+               peak_bin * sample_rate / analyser.frame_size());
+
+    // Track just the tone's bin and its neighbours sample by sample
+    std::print("\nSliding DFT...\n");
+    const std::vector<double> tracked{109.0, 110.0, 111.0};
+    keyq::sliding_dft<double> tracker(tracked, {.window = 256});
+    for (int i = 0; i < 1024; ++i) {
+        const double sample = std::sin(2.0 * std::numbers::pi * frequency * i / sample_rate);
+        tracker.push(&sample, 1);
+    }
+    for (size_t b = 0; b < tracker.size(); ++b)
+        std::print("bin {:.0f} ({:.1f} Hz): {:.2f}\n", tracked[b],
+                   tracked[b] * sample_rate / tracker.window(), std::abs(tracker.value(b)));
+
     // Clean up
     std::print("Cleaning up...\n");
     fftw_destroy_plan(plan);
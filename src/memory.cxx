@@ -0,0 +1,202 @@
+#include "memory.h"
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstdlib>
+#include <cstring>
+
+#if defined(__linux__)
+#include <sys/mman.h>
+#endif
+
+namespace keyq::memory {
+
+namespace {
+
+#if defined(__linux__) && defined(MADV_HUGEPAGE)
+constexpr bool huge_pages_supported = true;
+#else
+constexpr bool huge_pages_supported = false;
+#endif
+
+bool from_environment(const char *name) {
+    const char *value = std::getenv(name);
+    return value && *value && std::strcmp(value, "0") != 0;
+}
+
+std::atomic<bool> huge_pages{huge_pages_supported && from_environment("KEYQ_HUGEPAGES")};
+
+constexpr size_t huge_page = size_t{2} << 20;
+
+// Cached sizes are powers of 2 from one line to 4 MB; bigger blocks go straight back
+constexpr int bins = 17;
+constexpr size_t smallest = alignment;
+constexpr size_t largest = smallest << (bins - 1);
+
+// Enough for a few plans' worth of tables and scratch without hoarding
+constexpr int blocks_per_bin = 8;
+constexpr size_t bytes_per_thread = size_t{64} << 20;
+
+// Sits in the line before every block handed out
+struct alignas(alignment) header {
+    void *base;    // what the system returned
+    size_t length; // bytes from base, for releasing
+    int bin;       // -1 if not cached
+};
+
+static_assert(sizeof(header) == alignment);
+
+header *header_of(void *p) {
+    return static_cast<header *>(p) - 1;
+}
+
+int bin_of(size_t bytes) {
+    const size_t capacity = std::bit_ceil(std::max(bytes, smallest));
+    return capacity > largest ? -1 : std::countr_zero(capacity / smallest);
+}
+
+size_t round_up(size_t bytes, size_t to) {
+    return (bytes + to - 1) / to * to;
+}
+
+// A block with room for bytes after its header; huge-page aligned and advised when enabled
+// and big enough
+void *system_allocate(size_t bytes, int bin) {
+    const size_t total = sizeof(header) + bytes;
+    if (total < bytes)
+        return nullptr;
+    const bool huge = huge_pages_supported && total >= huge_page &&
+                      huge_pages.load(std::memory_order_relaxed);
+    const size_t align = huge ? huge_page : alignment;
+    const size_t length = round_up(total, align); // aligned_alloc needs a multiple
+    void *base = std::aligned_alloc(align, length);
+    if (!base)
+        return nullptr;
+#if defined(__linux__) && defined(MADV_HUGEPAGE)
+    if (huge)
+        madvise(base, length, MADV_HUGEPAGE);
+#endif
+    header *h = static_cast<header *>(base);
+    *h = {base, length, bin};
+    return h + 1;
+}
+
+void system_release(void *p) {
+    std::free(header_of(p)->base);
+}
+
+// Blocks this thread has released, per bin, linked through their first word. Blocks
+// released by a thread may have come from another; they're just as good.
+struct cache {
+    void *free[bins] = {};
+    int count[bins] = {};
+    size_t bytes = 0;
+
+    ~cache();
+};
+
+thread_local cache local;
+thread_local bool local_gone = false; // released blocks can't be cached after the cache goes
+
+cache::~cache() {
+    for (void *&head : free) {
+        while (head) {
+            void *next = *static_cast<void **>(head);
+            system_release(head);
+            head = next;
+        }
+    }
+    local_gone = true;
+}
+
+thread_local arena *active = nullptr;
+
+} // namespace
+
+void *allocate(size_t bytes) {
+    const int bin = bin_of(bytes);
+    if (bin < 0)
+        return system_allocate(bytes, bin);
+    if (!local_gone) {
+        if (void *p = local.free[bin]) {
+            local.free[bin] = *static_cast<void **>(p);
+            --local.count[bin];
+            local.bytes -= smallest << bin;
+            return p;
+        }
+    }
+    return system_allocate(smallest << bin, bin);
+}
+
+void release(void *p) {
+    if (!p)
+        return;
+    const int bin = header_of(p)->bin;
+    if (bin < 0 || local_gone || local.count[bin] >= blocks_per_bin ||
+        local.bytes + (smallest << bin) > bytes_per_thread) {
+        system_release(p);
+        return;
+    }
+    const size_t capacity = smallest << bin;
+    *static_cast<void **>(p) = local.free[bin];
+    local.free[bin] = p;
+    ++local.count[bin];
+    local.bytes += capacity;
+}
+
+bool use_huge_pages(bool on) {
+    if (!huge_pages_supported)
+        return false;
+    huge_pages = on;
+    return true;
+}
+
+// Chunks start small, since most plans' tables are a few KB, and double up to this
+constexpr size_t first_chunk = size_t{16} << 10;
+constexpr size_t last_chunk = size_t{1} << 20;
+
+arena::~arena() {
+    while (chunks_) {
+        void *next = *static_cast<void **>(chunks_);
+        release(chunks_);
+        chunks_ = next;
+    }
+}
+
+void *arena::allocate(size_t bytes) {
+    bytes = round_up(std::max<size_t>(bytes, 1), alignment);
+    if (bytes > static_cast<size_t>(end_ - cursor_)) {
+        // The first line of each chunk links it to the previous one
+        const size_t size = std::clamp(next_size_, first_chunk, last_chunk);
+        const bool dedicated = bytes + alignment > size;
+        char *chunk = static_cast<char *>(memory::allocate(dedicated ? bytes + alignment : size));
+        if (!chunk)
+            throw std::bad_alloc();
+        *reinterpret_cast<void **>(chunk) = chunks_;
+        chunks_ = chunk;
+        // A table bigger than a chunk gets one of its own and leaves the current chunk open
+        if (dedicated)
+            return chunk + alignment;
+        cursor_ = chunk + alignment;
+        end_ = chunk + size;
+        next_size_ = size * 2;
+    }
+    void *p = cursor_;
+    cursor_ += bytes;
+    return p;
+}
+
+arena *current() {
+    return active;
+}
+
+scope::scope(arena *a) : previous_(active) {
+    active = a;
+}
+
+scope::~scope() {
+    active = previous_;
+}
+
+} // namespace keyq::memory
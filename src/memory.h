@@ -0,0 +1,136 @@
+#pragma once
+
+#include <cstddef>
+#include <new>
+#include <vector>
+
+// Library-owned memory: everything is 64-byte aligned, small and medium blocks are recycled
+// through a per-thread cache instead of going back to the system, and large ones can be
+// backed by transparent huge pages. Plans keep their tables in an arena so one plan's data
+// sits together and is released in one go.
+namespace keyq::memory {
+
+// Cache line, and the widest vector the kernels load
+inline constexpr size_t alignment = 64;
+
+// Any size, zero included; null on failure. release takes only pointers from allocate, and
+// may be called from any thread.
+void *allocate(size_t bytes);
+void release(void *p);
+
+// Back new blocks of 2 MB or more with transparent huge pages (madvise on Linux; also set by
+// KEYQ_HUGEPAGES=1). Returns false, and changes nothing, where that isn't supported.
+bool use_huge_pages(bool on);
+
+// Bump allocator for one plan's tables. Chunks come from allocate and go back when the
+// arena is destroyed; nothing is released before that.
+class arena {
+  public:
+    arena() = default;
+    ~arena();
+
+    arena(const arena &) = delete;
+    arena &operator=(const arena &) = delete;
+
+    // Aligned to alignment; throws std::bad_alloc
+    void *allocate(size_t bytes);
+
+  private:
+    void *chunks_ = nullptr; // linked through each chunk's first word
+    char *cursor_ = nullptr;
+    char *end_ = nullptr;
+    size_t next_size_ = 0;
+};
+
+// Arena that tables built on this thread go into, if any
+arena *current();
+
+// Makes an arena current on this thread for its lifetime; null detaches tables built
+// meanwhile, e.g. the planner's trial engines, from the enclosing one
+class scope {
+  public:
+    explicit scope(arena *a);
+    ~scope();
+
+    scope(const scope &) = delete;
+    scope &operator=(const scope &) = delete;
+
+  private:
+    arena *previous_;
+};
+
+// Containers on allocate and release, e.g. per-thread scratch
+template <typename T>
+struct allocator {
+    using value_type = T;
+
+    allocator() = default;
+    template <typename U>
+    allocator(const allocator<U> &) {}
+
+    T *allocate(size_t n) {
+        if (void *p = memory::allocate(n * sizeof(T)))
+            return static_cast<T *>(p);
+        throw std::bad_alloc();
+    }
+
+    void deallocate(T *p, size_t) { release(p); }
+
+    bool operator==(const allocator &) const = default;
+};
+
+// Containers in the arena current when they were made, or on allocate without one. Arena
+// memory is only reclaimed with the arena, so these suit tables that are built once.
+template <typename T>
+struct arena_allocator {
+    using value_type = T;
+
+    arena *owner = current();
+
+    arena_allocator() = default;
+    template <typename U>
+    arena_allocator(const arena_allocator<U> &other) : owner(other.owner) {}
+
+    T *allocate(size_t n) {
+        if (owner)
+            return static_cast<T *>(owner->allocate(n * sizeof(T)));
+        if (void *p = memory::allocate(n * sizeof(T)))
+            return static_cast<T *>(p);
+        throw std::bad_alloc();
+    }
+
+    void deallocate(T *p, size_t) {
+        if (!owner)
+            release(p);
+    }
+
+    template <typename U>
+    bool operator==(const arena_allocator<U> &other) const {
+        return owner == other.owner;
+    }
+};
+
+template <typename T>
+using vector = std::vector<T, allocator<T>>;
+
+template <typename T>
+using table = std::vector<T, arena_allocator<T>>;
+
+// Construct and destroy an object on allocate and release
+template <typename T>
+T *create() {
+    void *p = allocate(sizeof(T));
+    if (!p)
+        return nullptr;
+    return new (p) T{};
+}
+
+template <typename T>
+void destroy(T *p) {
+    if (p) {
+        p->~T();
+        release(p);
+    }
+}
+
+} // namespace keyq::memory
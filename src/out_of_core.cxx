@@ -0,0 +1,333 @@
+#include "out_of_core.h"
+
+#include "thread_pool.h"
+
+#include <algorithm>
+#include <bit>
+#include <cerrno>
+#include <climits>
+#include <cmath>
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <numbers>
+#include <stdexcept>
+#include <system_error>
+#include <thread>
+#include <utility>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace keyq {
+
+namespace {
+
+// Used when the caller leaves the memory budget at 0
+constexpr size_t default_memory = size_t{256} << 20;
+
+// Rows moved together between a mapping and a band, so each column written in the band
+// gets a run of adjacent values rather than one
+constexpr long long row_tile = 8;
+
+[[noreturn]] void fail(const char *what) {
+    throw std::system_error(errno, std::generic_category(), what);
+}
+
+// n1, the largest divisor of n no bigger than sqrt(n), provided n2 = n / n1 is small enough
+// for a column of it to fit a band
+template <typename T>
+long long columns(long long n, size_t band_bytes) {
+    if (n < 1)
+        throw std::invalid_argument("out_of_core: n must be at least 1");
+    long long n1 = static_cast<long long>(std::sqrt(static_cast<double>(n)));
+    while (n1 * n1 > n)
+        --n1;
+    while (n % n1)
+        --n1;
+    const long long n2 = n / n1;
+    if (n2 > INT_MAX || static_cast<size_t>(n2) * sizeof(std::complex<T>) > band_bytes)
+        throw std::invalid_argument("out_of_core: n has no split into columns that fit in memory");
+    return n1;
+}
+
+// Ask for the pages behind a run of the mapping ahead of use; short runs are left to the
+// kernel's read-around on fault
+void will_need(const void *p, size_t bytes) {
+    static const size_t page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    if (bytes < page)
+        return;
+    const auto begin = reinterpret_cast<uintptr_t>(p) & ~(page - 1);
+    posix_madvise(reinterpret_cast<void *>(begin), reinterpret_cast<uintptr_t>(p) + bytes - begin,
+                  POSIX_MADV_WILLNEED);
+}
+
+// One thread for a pass's band I/O: start(b) hands it band b's step, wait(b) blocks until
+// that step is done and rethrows its error. Bands are started in order, one at a time.
+class band_io {
+  public:
+    explicit band_io(std::function<void(long long)> step)
+        : step_(std::move(step)), thread_([this] { loop(); }) {}
+
+    ~band_io() {
+        {
+            const std::lock_guard lock(mutex_);
+            quit_ = true;
+        }
+        changed_.notify_all();
+        thread_.join();
+    }
+
+    band_io(const band_io &) = delete;
+    band_io &operator=(const band_io &) = delete;
+
+    void start(long long band) {
+        {
+            const std::lock_guard lock(mutex_);
+            started_ = band;
+        }
+        changed_.notify_all();
+    }
+
+    void wait(long long band) {
+        std::unique_lock lock(mutex_);
+        changed_.wait(lock, [&] { return finished_ >= band; });
+        if (error_)
+            std::rethrow_exception(std::exchange(error_, nullptr));
+    }
+
+  private:
+    void loop() {
+        for (long long band = 0;; ++band) {
+            {
+                std::unique_lock lock(mutex_);
+                changed_.wait(lock, [&] { return quit_ || started_ >= band; });
+                if (started_ < band)
+                    return;
+            }
+            std::exception_ptr error;
+            try {
+                step_(band);
+            } catch (...) {
+                error = std::current_exception();
+            }
+            {
+                const std::lock_guard lock(mutex_);
+                finished_ = band;
+                error_ = error;
+            }
+            changed_.notify_all();
+        }
+    }
+
+    std::function<void(long long)> step_;
+    std::mutex mutex_;
+    std::condition_variable changed_;
+    long long started_ = -1;
+    long long finished_ = -1;
+    std::exception_ptr error_;
+    bool quit_ = false;
+    std::thread thread_; // last, so it starts once the rest is set up
+};
+
+} // namespace
+
+// Transform every column of a rows x cols row-major matrix in from, a band of width columns
+// at a time. A band holds its columns contiguously; it is stored to `to` either transposed
+// (column c becomes row c of a cols x rows matrix) or back where it came from.
+template <typename T>
+struct out_of_core<T>::pass {
+    const dft<T> *fft;
+    long long rows;
+    long long cols;
+    const complex *from;
+    complex *to;
+    bool transpose;
+    bool twiddle; // by w_n^(column x row)
+    T scale;
+};
+
+template <typename T>
+out_of_core<T>::out_of_core(long long n, const std::string &in, const std::string &out,
+                            int sign, size_t memory, T scale, int threads, rigor effort)
+    : n_(n), n1_(columns<T>(n, (memory ? memory : default_memory) / 2)), n2_(n / n1_),
+      sign_(sign), scale_(scale), threads_(threads),
+      band_bytes_((memory ? memory : default_memory) / 2),
+      first_(static_cast<int>(n1_), sign, 1, effort),
+      second_(static_cast<int>(n2_), sign, 1, effort) {
+    fine_bits_ = (std::bit_width(static_cast<unsigned long long>(n - 1)) + 1) / 2;
+    const long long fine = 1LL << fine_bits_;
+    fine_.resize(fine);
+    coarse_.resize(((n - 1) >> fine_bits_) + 1);
+    const auto root = [&](long long k) {
+        const double angle = sign * 2.0 * std::numbers::pi * static_cast<double>(k) / n;
+        return std::complex<double>(std::cos(angle), std::sin(angle));
+    };
+    for (long long m = 0; m < fine; ++m)
+        fine_[m] = root(m);
+    for (size_t h = 0; h < coarse_.size(); ++h)
+        coarse_[h] = root(static_cast<long long>(h) * fine);
+
+    length_ = static_cast<size_t>(n) * sizeof(complex);
+    try {
+        in_fd_ = open(in.c_str(), O_RDONLY);
+        if (in_fd_ < 0)
+            fail("out_of_core: open input");
+        out_fd_ = open(out.c_str(), O_RDWR | O_CREAT, 0644);
+        if (out_fd_ < 0)
+            fail("out_of_core: open output");
+
+        struct stat in_stat, out_stat;
+        if (fstat(in_fd_, &in_stat) || fstat(out_fd_, &out_stat))
+            fail("out_of_core: stat");
+        if (in_stat.st_dev == out_stat.st_dev && in_stat.st_ino == out_stat.st_ino)
+            throw std::invalid_argument("out_of_core: input and output must be different files");
+        if (static_cast<size_t>(in_stat.st_size) < length_)
+            throw std::invalid_argument("out_of_core: input is shorter than n values");
+        if (static_cast<size_t>(out_stat.st_size) != length_ &&
+            ftruncate(out_fd_, static_cast<off_t>(length_)))
+            fail("out_of_core: resize output");
+
+        void *in_map = mmap(nullptr, length_, PROT_READ, MAP_SHARED, in_fd_, 0);
+        if (in_map == MAP_FAILED)
+            fail("out_of_core: map input");
+        in_ = static_cast<const complex *>(in_map);
+        void *out_map = mmap(nullptr, length_, PROT_READ | PROT_WRITE, MAP_SHARED, out_fd_, 0);
+        if (out_map == MAP_FAILED)
+            fail("out_of_core: map output");
+        out_ = static_cast<complex *>(out_map);
+    } catch (...) {
+        unmap();
+        throw;
+    }
+}
+
+template <typename T>
+out_of_core<T>::~out_of_core() {
+    unmap();
+}
+
+template <typename T>
+void out_of_core<T>::unmap() {
+    if (out_)
+        munmap(out_, length_);
+    if (in_)
+        munmap(const_cast<complex *>(in_), length_);
+    if (out_fd_ >= 0)
+        close(out_fd_);
+    if (in_fd_ >= 0)
+        close(in_fd_);
+    out_ = nullptr;
+    in_ = nullptr;
+    out_fd_ = in_fd_ = -1;
+}
+
+template <typename T>
+std::string out_of_core<T>::describe() const {
+    return "out_of_core " + std::to_string(n1_) + " x " + std::to_string(n2_) + ": " +
+           first_.describe() + " / " + second_.describe();
+}
+
+template <typename T>
+void out_of_core<T>::execute() const {
+    // The n1-point columns of the input, twiddled and stored transposed: after this, out is
+    // n2 x n1 and its columns are what the second pass transforms in place
+    run({&first_, n1_, n2_, in_, out_, true, true, T(1)});
+    run({&second_, n2_, n1_, out_, out_, false, false, scale_});
+}
+
+template <typename T>
+void out_of_core<T>::run(const pass &p) const {
+    const long long width = std::clamp<long long>(
+        static_cast<long long>(band_bytes_ / (p.rows * sizeof(complex))), 1, p.cols);
+    const long long bands = (p.cols + width - 1) / width;
+    memory::vector<complex> buffers[2];
+    for (auto &b : buffers)
+        b.resize(static_cast<size_t>(width * p.rows));
+
+    const auto columns_in = [&](long long band) {
+        return std::min(width, p.cols - band * width);
+    };
+
+    // Band of columns [c, c + w) from the rows of the source, a tile of rows at a time
+    const auto load = [&](long long band, complex *buffer) {
+        const long long c = band * width;
+        const long long w = columns_in(band);
+        for (long long r = 0; r < p.rows; ++r)
+            will_need(p.from + r * p.cols + c, w * sizeof(complex));
+        for (long long r0 = 0; r0 < p.rows; r0 += row_tile) {
+            const long long r1 = std::min(r0 + row_tile, p.rows);
+            for (long long j = 0; j < w; ++j)
+                for (long long r = r0; r < r1; ++r)
+                    buffer[j * p.rows + r] = p.from[r * p.cols + c + j];
+        }
+    };
+
+    const auto store = [&](long long band, const complex *buffer) {
+        const long long c = band * width;
+        const long long w = columns_in(band);
+        if (p.transpose) {
+            std::copy_n(buffer, w * p.rows, p.to + c * p.rows);
+            return;
+        }
+        for (long long r0 = 0; r0 < p.rows; r0 += row_tile) {
+            const long long r1 = std::min(r0 + row_tile, p.rows);
+            for (long long j = 0; j < w; ++j)
+                for (long long r = r0; r < r1; ++r)
+                    p.to[r * p.cols + c + j] = buffer[j * p.rows + r] * p.scale;
+        }
+    };
+
+    const auto transform = [&](long long band, complex *buffer) {
+        const long long c = band * width;
+        const long long w = columns_in(band);
+        const size_t mask = (size_t{1} << fine_bits_) - 1;
+        pool::parallel_for(threads_, static_cast<size_t>(w), [&](size_t begin, size_t end) {
+            complex *work = task_scratch<T>(p.fft->scratch_size());
+            for (size_t j = begin; j < end; ++j) {
+                complex *column = buffer + j * p.rows;
+                p.fft->execute(column, column, work);
+                if (!p.twiddle)
+                    continue;
+                // Row k of column c + j takes w_n^(k (c + j)), the exponent kept below n
+                const long long step = c + static_cast<long long>(j);
+                long long m = 0;
+                for (long long k = 0; k < p.rows; ++k) {
+                    const std::complex<double> w = fine_[static_cast<size_t>(m) & mask] *
+                                                   coarse_[static_cast<size_t>(m) >> fine_bits_];
+                    column[k] = complex(std::complex<double>(column[k]) * w);
+                    m += step;
+                    if (m >= n_)
+                        m -= n_;
+                }
+            }
+        });
+    };
+
+    // While band b is transformed, the other buffer writes band b - 1 out and reads b + 1 in
+    load(0, buffers[0].data());
+    {
+        band_io io([&](long long b) {
+            complex *other = buffers[(b + 1) % 2].data();
+            if (b > 0)
+                store(b - 1, other);
+            if (b + 1 < bands)
+                load(b + 1, other);
+        });
+        for (long long b = 0; b < bands; ++b) {
+            io.start(b);
+            transform(b, buffers[b % 2].data());
+            io.wait(b);
+        }
+    }
+    store(bands - 1, buffers[(bands - 1) % 2].data());
+}
+
+template class out_of_core<float>;
+template class out_of_core<double>;
+
+} // namespace keyq
@@ -0,0 +1,78 @@
+#pragma once
+
+#include "dft.h"
+
+#include <complex>
+#include <cstddef>
+#include <string>
+
+namespace keyq {
+
+// 1D complex transform of a file too big for memory, by the six-step decomposition with its
+// transposes folded into the I/O. With n = n1 n2 and the input an n1 x n2 row-major matrix:
+//
+//   1. bands of whole columns are read, the n1-point columns transformed and twiddled by
+//      w_n^(j2 k1), and each band written out transposed, as contiguous rows of n2 x n1;
+//   2. bands of columns of that are read, the n2-point columns transformed and written back
+//      in place, which leaves X[k1 + n1 k2] in natural order.
+//
+// Both files are memory-mapped. Bands go through two buffers that share the memory budget:
+// while one is transformed, an I/O thread started once per pass writes the last band out and
+// reads the next one in, so the I/O overlaps the arithmetic. The tables are O(sqrt n) on top of the budget.
+template <typename T>
+class out_of_core {
+  public:
+    using complex = std::complex<T>;
+
+    // in holds n complex values of T, native byte order; out is created or resized to match
+    // and must be a different file. Throws std::system_error if either can't be opened or
+    // mapped, std::invalid_argument if n can't be split into columns that fit in memory.
+    out_of_core(long long n, const std::string &in, const std::string &out, int sign,
+                size_t memory, T scale, int threads = 1, rigor effort = rigor::estimate);
+    ~out_of_core();
+
+    out_of_core(const out_of_core &) = delete;
+    out_of_core &operator=(const out_of_core &) = delete;
+
+    long long size() const { return n_; }
+
+    // e.g. "out_of_core 65536 x 131072: radix2 avx2 / radix2 avx2"
+    std::string describe() const;
+
+    // Transform in into out; may be called again, e.g. after the input file changes
+    void execute() const;
+
+  private:
+    struct pass;
+
+    void run(const pass &p) const;
+    void unmap();
+
+    long long n_;
+    long long n1_;
+    long long n2_;
+    int sign_;
+    T scale_;
+    int threads_;
+    size_t band_bytes_; // per buffer
+
+    // Column transforms of each pass
+    dft<T> first_;
+    dft<T> second_;
+
+    // w_n^m = fine[m mod 2^b] coarse[m >> b], kept in double whatever T is
+    int fine_bits_;
+    memory::table<std::complex<double>> fine_;
+    memory::table<std::complex<double>> coarse_;
+
+    int in_fd_ = -1;
+    int out_fd_ = -1;
+    const complex *in_ = nullptr;
+    complex *out_ = nullptr;
+    size_t length_ = 0; // bytes mapped from each file
+};
+
+extern template class out_of_core<float>;
+extern template class out_of_core<double>;
+
+} // namespace keyq
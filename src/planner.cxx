@@ -0,0 +1,201 @@
+#include "planner.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <map>
+#include <mutex>
+#include <sstream>
+
+namespace keyq::planner {
+
+namespace {
+
+struct key {
+    char precision; // 'd' or 'f'
+    int n;
+    int sign;
+    bool threaded;
+
+    auto operator<=>(const key &) const = default;
+};
+
+struct entry {
+    rigor effort;
+    recipe chosen;
+};
+
+std::mutex mutex;
+std::map<key, entry> wisdom;
+std::atomic<double> time_limit{-1.0};
+
+template <typename T>
+constexpr char precision = sizeof(T) == sizeof(float) ? 'f' : 'd';
+
+constexpr const char *effort_names[] = {"estimate", "measure", "patient", "exhaustive"};
+
+using clock = std::chrono::steady_clock;
+
+double seconds_since(clock::time_point start) {
+    return std::chrono::duration<double>(clock::now() - start).count();
+}
+
+// Seconds per transform, best of three samples that each repeat it for at least a
+// millisecond. Out-of-place from a fixed input so repeated runs can't overflow.
+template <typename T>
+double time_per_run(const dft<T> &engine) {
+    const int n = engine.size();
+    std::vector<std::complex<T>> in(n), out(n), scratch(engine.scratch_size());
+    for (int i = 0; i < n; ++i)
+        in[i] = {static_cast<T>(i % 7) - 3, static_cast<T>(i % 5) - 2};
+    engine.execute(in.data(), out.data(), scratch.data());
+
+    int reps = 1;
+    double best = INFINITY;
+    for (int sample = 0; sample < 3; ++sample) {
+        for (;;) {
+            const auto start = clock::now();
+            for (int i = 0; i < reps; ++i)
+                engine.execute(in.data(), out.data(), scratch.data());
+            const double elapsed = seconds_since(start);
+            if (elapsed >= 1e-3 || reps >= (1 << 20)) {
+                best = std::min(best, elapsed / reps);
+                break;
+            }
+            reps *= 2;
+        }
+    }
+    return best;
+}
+
+template <typename T, size_t N>
+bool lookup(const std::string &name, const char *const (&names)[N], T &out) {
+    for (size_t i = 0; i < N; ++i) {
+        if (name == names[i]) {
+            out = static_cast<T>(i);
+            return true;
+        }
+    }
+    return false;
+}
+
+} // namespace
+
+template <typename T>
+recipe choose(int n, int sign, int threads, rigor effort) {
+    const key k{precision<T>, n, sign < 0 ? -1 : 1, threads > 1};
+    {
+        std::lock_guard lock(mutex);
+        if (const auto it = wisdom.find(k); it != wisdom.end() && it->second.effort >= effort)
+            return it->second.chosen;
+    }
+    if (effort == rigor::estimate || n < 2)
+        return dft<T>::heuristic(n, threads);
+
+    // The heuristic goes first, so even a zero time limit leaves a sensible answer
+    const auto candidates = dft<T>::candidates(n, threads, effort);
+    recipe best = candidates.front();
+    if (candidates.size() > 1) {
+        // Trial engines are thrown away, so keep them out of the plan's arena
+        const memory::scope detached(nullptr);
+        const double limit = time_limit.load();
+        const auto start = clock::now();
+        double best_time = INFINITY;
+        for (const recipe &candidate : candidates) {
+            if (limit >= 0 && best_time < INFINITY && seconds_since(start) > limit)
+                break;
+            const double t = time_per_run(dft<T>(n, sign, threads, candidate));
+            if (t < best_time) {
+                best_time = t;
+                best = candidate;
+            }
+        }
+    }
+
+    std::lock_guard lock(mutex);
+    wisdom[k] = {effort, best};
+    return best;
+}
+
+void set_time_limit(double seconds) {
+    time_limit = seconds;
+}
+
+void forget() {
+    std::lock_guard lock(mutex);
+    wisdom.clear();
+}
+
+// One entry per line: precision, n, sign, threaded, effort, algorithm, kernels (- for the
+// default), then the radices
+std::string export_wisdom() {
+    std::ostringstream text;
+    text << "(keyq-wisdom\n";
+    std::lock_guard lock(mutex);
+    for (const auto &[k, e] : wisdom) {
+        text << "  (" << k.precision << ' ' << k.n << ' ' << k.sign << ' ' << k.threaded << ' '
+             << effort_names[static_cast<int>(e.effort)] << ' '
+             << algorithm_names[static_cast<int>(e.chosen.algorithm)] << ' '
+             << (e.chosen.kernels.empty() ? "-" : e.chosen.kernels);
+        for (const int r : e.chosen.radices)
+            text << ' ' << r;
+        text << ")\n";
+    }
+    text << ")\n";
+    return text.str();
+}
+
+bool import_wisdom(const std::string &text) {
+    std::istringstream lines(text);
+    std::string line;
+    if (!std::getline(lines, line) || line != "(keyq-wisdom")
+        return false;
+
+    std::map<key, entry> parsed;
+    bool closed = false;
+    while (std::getline(lines, line)) {
+        if (line == ")") {
+            closed = true;
+            break;
+        }
+        const auto open = line.find('(');
+        const auto close = line.rfind(')');
+        if (open == std::string::npos || close == std::string::npos || close < open)
+            return false;
+
+        std::istringstream fields(line.substr(open + 1, close - open - 1));
+        key k{};
+        entry e{};
+        std::string effort, algorithm;
+        int threaded = 0;
+        if (!(fields >> k.precision >> k.n >> k.sign >> threaded >> effort >> algorithm >>
+              e.chosen.kernels))
+            return false;
+        if ((k.precision != 'd' && k.precision != 'f') || k.n < 1 || (k.sign != -1 && k.sign != 1))
+            return false;
+        if (!lookup(effort, effort_names, e.effort) ||
+            !lookup(algorithm, algorithm_names, e.chosen.algorithm))
+            return false;
+        k.threaded = threaded != 0;
+        if (e.chosen.kernels == "-")
+            e.chosen.kernels.clear();
+        for (int r; fields >> r;)
+            e.chosen.radices.push_back(r);
+        if (!fields.eof())
+            return false;
+        parsed[k] = std::move(e);
+    }
+    if (!closed)
+        return false;
+
+    std::lock_guard lock(mutex);
+    for (auto &[k, e] : parsed)
+        wisdom[k] = std::move(e);
+    return true;
+}
+
+template recipe choose<float>(int, int, int, rigor);
+template recipe choose<double>(int, int, int, rigor);
+
+} // namespace keyq::planner
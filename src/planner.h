@@ -0,0 +1,26 @@
+#pragma once
+
+#include "dft.h"
+
+#include <string>
+
+// Measuring planner and its wisdom. Recipes found by timing are remembered per precision,
+// size, direction and whether the plan is threaded, together with the effort that found
+// them, and can be saved and restored as text so a service starts with tuned plans.
+namespace keyq::planner {
+
+// Recipe for an n-point transform: wisdom found with at least this effort, else the
+// heuristic for estimate, else the fastest candidate timed now, which is then remembered
+template <typename T>
+recipe choose(int n, int sign, int threads, rigor effort);
+
+// Seconds each size may spend measuring; negative means no limit
+void set_time_limit(double seconds);
+
+void forget();
+std::string export_wisdom();
+
+// Merge wisdom from text written by export_wisdom; on a parse error nothing is changed
+bool import_wisdom(const std::string &text);
+
+} // namespace keyq::planner
@@ -0,0 +1,376 @@
+#include "r2r.h"
+
+#include <algorithm>
+#include <cmath>
+#include <numbers>
+#include <stdexcept>
+
+namespace keyq {
+
+namespace {
+
+constexpr const char *kind_names[] = {"r2hc",    "hc2r",    "dht",     "redft00",
+                                      "redft01", "redft10", "redft11", "rodft00",
+                                      "rodft01", "rodft10", "rodft11"};
+
+// Complex elements that hold n reals
+constexpr size_t complexes(size_t n) {
+    return (n + 1) / 2;
+}
+
+// exp(-i pi k / d), in double whatever T is
+template <typename T>
+std::complex<T> quarter(double k, double d) {
+    const double angle = -std::numbers::pi * k / d;
+    return {static_cast<T>(std::cos(angle)), static_cast<T>(std::sin(angle))};
+}
+
+template <typename C>
+inline C mul(const C &a, const C &b) {
+    return {a.real() * b.real() - a.imag() * b.imag(), a.real() * b.imag() + a.imag() * b.real()};
+}
+
+} // namespace
+
+template <typename T>
+r2r<T>::r2r(r2r_kind kind, int n, int threads, rigor effort) : kind_(kind), n_(n) {
+    if (kind < r2r_kind::r2hc || kind > r2r_kind::rodft11)
+        throw std::invalid_argument("r2r: unknown kind");
+    if (n < 1 || (kind == r2r_kind::redft00 && n < 2))
+        throw std::invalid_argument("r2r: n must be at least 1, or 2 for REDFT00");
+
+    const int half = n / 2;
+    switch (kind) {
+        case r2r_kind::r2hc:
+        case r2r_kind::dht:
+        case r2r_kind::hc2r:
+            real_ = std::make_unique<rdft<T>>(n, kind == r2r_kind::hc2r ? 1 : -1, threads, effort);
+            work_ = half + 1;
+            break;
+        case r2r_kind::redft10:
+        case r2r_kind::rodft10:
+        case r2r_kind::redft01:
+        case r2r_kind::rodft01: {
+            const bool dct2 = kind == r2r_kind::redft10 || kind == r2r_kind::rodft10;
+            real_ = std::make_unique<rdft<T>>(n, dct2 ? -1 : 1, threads, effort);
+            work_ = half + 1;
+            twiddles_.resize(half + 1);
+            for (int k = 0; k <= half; ++k)
+                twiddles_[k] = quarter<T>(k, 2.0 * n);
+            break;
+        }
+        case r2r_kind::redft11:
+        case r2r_kind::rodft11:
+            if (n % 2 == 0) {
+                complex_ = std::make_unique<dft<T>>(half, -1, threads, effort);
+                work_ = half;
+                twiddles_.resize(half);
+                post_.resize(half);
+                for (int j = 0; j < half; ++j) {
+                    twiddles_[j] = quarter<T>(4.0 * j + 1, 4.0 * n);
+                    post_[j] = quarter<T>(j, n);
+                }
+            } else {
+                complex_ = std::make_unique<dft<T>>(2 * n, -1, threads, effort);
+                work_ = 2 * static_cast<size_t>(n);
+                twiddles_.resize(n);
+                post_.resize(n);
+                for (int j = 0; j < n; ++j) {
+                    twiddles_[j] = quarter<T>(j, 2.0 * n);
+                    post_[j] = quarter<T>(2.0 * j + 1, 4.0 * n);
+                }
+            }
+            break;
+        case r2r_kind::redft00:
+            real_ = std::make_unique<rdft<T>>(2 * (n - 1), -1, threads, effort);
+            work_ = n;
+            break;
+        case r2r_kind::rodft00:
+            real_ = std::make_unique<rdft<T>>(2 * (n + 1), -1, threads, effort);
+            work_ = n + 2;
+            break;
+    }
+}
+
+template <typename T>
+size_t r2r<T>::scratch_size() const {
+    return work_ + (real_ ? real_->scratch_size() : complex_->scratch_size());
+}
+
+template <typename T>
+std::string r2r<T>::describe() const {
+    return std::string(kind_names[static_cast<int>(kind_)]) + " " +
+           (real_ ? real_->describe() : complex_->describe());
+}
+
+template <typename T>
+void r2r<T>::execute(const T *in, T *out, complex *scratch) const {
+    const int n = n_;
+    complex *work = scratch;
+    complex *inner = scratch + work_;
+    auto *v = reinterpret_cast<T *>(work);
+
+    switch (kind_) {
+        case r2r_kind::r2hc:
+        case r2r_kind::dht: {
+            real_->forward(in, work, inner);
+            const bool hartley = kind_ == r2r_kind::dht;
+            for (int k = 0; k <= n / 2; ++k) {
+                const complex x = work[k];
+                out[k] = hartley ? x.real() - x.imag() : x.real();
+                if (k > 0 && k < n - k)
+                    out[n - k] = hartley ? x.real() + x.imag() : x.imag();
+            }
+            return;
+        }
+        case r2r_kind::hc2r:
+            work[0] = {in[0], T(0)};
+            for (int k = 1; k <= n / 2; ++k)
+                work[k] = {in[k], k < n - k ? in[n - k] : T(0)};
+            real_->backward(work, out, inner);
+            return;
+        case r2r_kind::redft10:
+        case r2r_kind::rodft10:
+            dct2(in, out, work, inner, kind_ == r2r_kind::rodft10);
+            return;
+        case r2r_kind::redft01:
+        case r2r_kind::rodft01:
+            dct3(in, out, work, inner, kind_ == r2r_kind::rodft01);
+            return;
+        case r2r_kind::redft11:
+        case r2r_kind::rodft11:
+            dct4(in, out, work, inner, kind_ == r2r_kind::rodft11);
+            return;
+        case r2r_kind::redft00: {
+            // Even extension x0 .. x(n-1) .. x1, whose real spectrum is the DCT-I
+            const int m = 2 * (n - 1);
+            for (int j = 0; j < n; ++j)
+                v[j] = in[j];
+            for (int j = 1; j < n - 1; ++j)
+                v[m - j] = in[j];
+            real_->forward(v, work, inner);
+            for (int k = 0; k < n; ++k)
+                out[k] = work[k].real();
+            return;
+        }
+        case r2r_kind::rodft00: {
+            // Odd extension 0 x0 .. x(n-1) 0 -x(n-1) .. -x0, whose spectrum is -i DST-I
+            const int m = 2 * (n + 1);
+            v[0] = v[n + 1] = T(0);
+            for (int j = 0; j < n; ++j) {
+                v[j + 1] = in[j];
+                v[m - 1 - j] = -in[j];
+            }
+            real_->forward(v, work, inner);
+            for (int k = 0; k < n; ++k)
+                out[k] = -work[k + 1].imag();
+            return;
+        }
+    }
+}
+
+// Makhoul: v = x0 x2 x4 .. x5 x3 x1 and Y_k = 2 Re(exp(-i pi k / 2n) V_k), with
+// Y_n-k = -2 Im of the same product. DST-II is the DCT-II of x with its odd samples negated,
+// read backwards.
+template <typename T>
+void r2r<T>::dct2(const T *in, T *out, complex *work, complex *scratch, bool sine) const {
+    const int n = n_;
+    auto *v = reinterpret_cast<T *>(work);
+    for (int i = 0; i < n; ++i) {
+        const T x = sine && (i & 1) ? -in[i] : in[i];
+        v[i & 1 ? n - 1 - i / 2 : i / 2] = x;
+    }
+    real_->forward(v, work, scratch);
+
+    const auto put = [&](int k, T y) { out[sine ? n - 1 - k : k] = y; };
+    put(0, 2 * work[0].real());
+    for (int k = 1; k <= n / 2; ++k) {
+        const complex u = mul(twiddles_[k], work[k]);
+        put(k, 2 * u.real());
+        if (k < n - k)
+            put(n - k, -2 * u.imag());
+    }
+}
+
+// The inverse of the above up to 2n: V_j = exp(i pi j / 2n) (x_j - i x_n-j) is Hermitian,
+// an inverse real transform of it gives v, and v is put back in x's order. DST-III is the
+// DCT-III of x reversed, with alternate outputs negated.
+template <typename T>
+void r2r<T>::dct3(const T *in, T *out, complex *work, complex *scratch, bool sine) const {
+    const int n = n_;
+    const auto sample = [&](int j) { return j == n ? T(0) : sine ? in[n - 1 - j] : in[j]; };
+    for (int j = 0; j <= n / 2; ++j)
+        work[j] = mul(std::conj(twiddles_[j]), complex{sample(j), -sample(n - j)});
+
+    auto *v = reinterpret_cast<T *>(work);
+    real_->backward(work, v, scratch);
+    for (int i = 0; i < n; ++i) {
+        const T y = v[i & 1 ? n - 1 - i / 2 : i / 2];
+        out[i] = sine && (i & 1) ? -y : y;
+    }
+}
+
+// Even n folds x_2j + i x_n-1-2j into an n/2-point complex transform between two twiddles,
+// then Y_2k = 2 Re and Y_n-1-2k = -2 Im of each result. Odd n is the direct form, 2 Re of
+// exp(-i pi (k + 1/2) / 2n) times the 2n-point transform of x_j exp(-i pi j / 2n). DST-IV
+// is the DCT-IV of x reversed, with alternate outputs negated.
+template <typename T>
+void r2r<T>::dct4(const T *in, T *out, complex *work, complex *scratch, bool sine) const {
+    const int n = n_;
+    const auto sample = [&](int j) { return sine ? in[n - 1 - j] : in[j]; };
+    const auto put = [&](int k, T y) { out[k] = sine && (k & 1) ? -y : y; };
+
+    if (n % 2 == 0) {
+        const int half = n / 2;
+        for (int j = 0; j < half; ++j)
+            work[j] = mul(complex{sample(2 * j), sample(n - 1 - 2 * j)}, twiddles_[j]);
+        complex_->execute(work, work, scratch);
+        for (int k = 0; k < half; ++k) {
+            const complex c = mul(work[k], post_[k]);
+            put(2 * k, 2 * c.real());
+            put(n - 1 - 2 * k, -2 * c.imag());
+        }
+        return;
+    }
+
+    for (int j = 0; j < n; ++j)
+        work[j] = sample(j) * twiddles_[j];
+    std::fill(work + n, work + 2 * n, complex{});
+    complex_->execute(work, work, scratch);
+    for (int k = 0; k < n; ++k)
+        put(k, 2 * mul(work[k], post_[k]).real());
+}
+
+template <typename T>
+r2r_batch<T>::r2r_batch(const std::vector<int> &dims, const std::vector<r2r_kind> &kinds,
+                        int howmany, const layout &in, const layout &out, int threads,
+                        rigor effort)
+    : dims_(dims), size_(1), howmany_(howmany), in_(in), out_(out), threads_(threads) {
+    if (dims.empty() || kinds.size() != dims.size())
+        throw std::invalid_argument("r2r: needs one kind per dimension");
+
+    // Threads go across the batch, across rows and tiles, or inside a lone 1D engine
+    const int inside = howmany > 1 || dims.size() > 1 ? 1 : threads;
+    for (size_t k = 0; k < dims.size(); ++k) {
+        size_ *= dims[k];
+        std::shared_ptr<const r2r<T>> engine;
+        for (size_t j = 0; j < axes_.size() && !engine; ++j)
+            if (dims_[j] == dims[k] && axes_[j]->kind() == kinds[k])
+                engine = axes_[j];
+        if (!engine)
+            engine = std::make_shared<const r2r<T>>(kinds[k], dims[k], inside, effort);
+        axes_.push_back(engine);
+    }
+
+    direct_ = is_contiguous(dims_, in_.embed, in_.stride) &&
+              is_contiguous(dims_, out_.embed, out_.stride);
+    if (!direct_) {
+        in_offsets_ = element_offsets(dims_, in_.embed, in_.stride);
+        out_offsets_ = element_offsets(dims_, out_.embed, out_.stride);
+    }
+}
+
+template <typename T>
+size_t r2r_batch<T>::scratch_size() const {
+    size_t largest = 0;
+    for (size_t k = 0; k < axes_.size(); ++k) {
+        const size_t tiles = k + 1 < axes_.size() ? complexes(tile * dims_[k]) : 0;
+        largest = std::max(largest, tiles + axes_[k]->scratch_size());
+    }
+    return largest + (direct_ ? 0 : complexes(size_));
+}
+
+template <typename T>
+std::string r2r_batch<T>::describe() const {
+    std::string text;
+    for (const auto &engine : axes_)
+        text += (text.empty() ? "" : " x ") + engine->describe();
+    return text;
+}
+
+template <typename T>
+void r2r_batch<T>::execute(const T *in, T *out, complex *scratch) const {
+    // One transform at a time gets every thread; a batch gives each its own transforms
+    const int per_transform = howmany_ > 1 ? 1 : threads_;
+    const int across = howmany_ > 1 ? threads_ : 1;
+
+    split<T>(across, howmany_, scratch_size(), scratch,
+             [&](size_t begin, size_t end, complex *local) {
+                 for (size_t b = begin; b < end; ++b) {
+                     const T *src = in + static_cast<ptrdiff_t>(b) * in_.dist;
+                     T *dst = out + static_cast<ptrdiff_t>(b) * out_.dist;
+                     if (direct_) {
+                         transform(src, dst, local, per_transform);
+                         continue;
+                     }
+
+                     auto *buffer = reinterpret_cast<T *>(local);
+                     for (size_t j = 0; j < size_; ++j)
+                         buffer[j] = src[in_offsets_[j]];
+                     transform(buffer, buffer, local + complexes(size_), per_transform);
+                     for (size_t j = 0; j < size_; ++j)
+                         dst[out_offsets_[j]] = buffer[j];
+                 }
+             });
+}
+
+template <typename T>
+void r2r_batch<T>::transform(const T *in, T *data, complex *scratch, int threads) const {
+    const int last = static_cast<int>(dims_.size()) - 1;
+    const r2r<T> &row = *axes_[last];
+    const size_t n = dims_[last];
+    split<T>(threads, size_ / n, row.scratch_size(), scratch,
+             [&](size_t begin, size_t end, complex *work) {
+                 for (size_t r = begin * n; r < end * n; r += n)
+                     row.execute(in + r, data + r, work);
+             });
+
+    for (int k = last - 1; k >= 0; --k)
+        axis(k, data, scratch, threads);
+}
+
+template <typename T>
+void r2r_batch<T>::axis(int k, T *data, complex *scratch, int threads) const {
+    const r2r<T> &engine = *axes_[k];
+    const size_t n = dims_[k];
+
+    size_t inner = 1;
+    for (size_t d = k + 1; d < dims_.size(); ++d)
+        inner *= dims_[d];
+    const size_t outer = size_ / (n * inner);
+    const size_t tiles = (inner + tile - 1) / tile;
+    const size_t staged = complexes(tile * n);
+
+    split<T>(threads, outer * tiles, staged + engine.scratch_size(), scratch,
+             [&](size_t begin, size_t end, complex *local) {
+                 auto *buffer = reinterpret_cast<T *>(local);
+                 complex *work = local + staged;
+                 for (size_t t = begin; t < end; ++t) {
+                     T *base = data + (t / tiles) * n * inner;
+                     const size_t c = (t % tiles) * tile;
+                     const size_t width = std::min(tile, inner - c);
+
+                     for (size_t j = 0; j < n; ++j) {
+                         const T *src = base + j * inner + c;
+                         for (size_t b = 0; b < width; ++b)
+                             buffer[b * n + j] = src[b];
+                     }
+
+                     for (size_t b = 0; b < width; ++b)
+                         engine.execute(buffer + b * n, buffer + b * n, work);
+
+                     for (size_t j = 0; j < n; ++j) {
+                         T *dst = base + j * inner + c;
+                         for (size_t b = 0; b < width; ++b)
+                             dst[b] = buffer[b * n + j];
+                     }
+                 }
+             });
+}
+
+template class r2r<float>;
+template class r2r<double>;
+template class r2r_batch<float>;
+template class r2r_batch<double>;
+
+} // namespace keyq
@@ -0,0 +1,125 @@
+#pragma once
+
+#include "dft.h"
+
+#include <complex>
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace keyq {
+
+// FFTW's real-to-real kinds, in the order of its fftw_r2r_kind values
+enum class r2r_kind {
+    r2hc,    // halfcomplex spectrum: Re X[0..n/2], then Im X[(n-1)/2..1]
+    hc2r,    // its inverse, unnormalised
+    dht,     // discrete Hartley transform
+    redft00, // DCT-I
+    redft01, // DCT-III
+    redft10, // DCT-II
+    redft11, // DCT-IV
+    rodft00, // DST-I
+    rodft01, // DST-III
+    rodft10, // DST-II
+    rodft11, // DST-IV
+};
+
+// Unnormalised 1D real-to-real transform of one kind, with FFTW's definitions: DCT-II then
+// DCT-III, for instance, multiplies by 2n. Every kind is one real or complex FFT between
+// O(n) passes that reorder, fold or twiddle:
+//
+//   DCT-II    samples reordered evens-then-reversed-odds, an n-point real FFT, then a
+//             quarter-sample twiddle (Makhoul)
+//   DCT-III   the reverse: twiddle to a Hermitian spectrum, n-point inverse real FFT, reorder
+//   DCT-IV    pairs folded into an n/2-point complex FFT between two twiddles; odd n
+//             twiddles into a zero-padded 2n-point complex FFT
+//   DCT-I     the even extension, a 2(n-1)-point real FFT
+//   DST-I     the odd extension, a 2(n+1)-point real FFT
+//   DST-II..IV  the DCT of the same type with the input's odd samples negated or reversed
+//
+// Tables are built by the constructor and execute() never writes to the object.
+template <typename T>
+class r2r {
+  public:
+    using complex = std::complex<T>;
+
+    // Throws std::invalid_argument for an unknown kind, or unless n >= 1, or n >= 2 for DCT-I
+    r2r(r2r_kind kind, int n, int threads = 1, rigor effort = rigor::estimate);
+
+    r2r_kind kind() const { return kind_; }
+    int size() const { return n_; }
+    size_t scratch_size() const;
+
+    // Kind and engine, e.g. "redft10 radix2 avx2"
+    std::string describe() const;
+
+    // n reals in, n reals out; in may be out
+    void execute(const T *in, T *out, complex *scratch) const;
+
+  private:
+    void dct2(const T *in, T *out, complex *work, complex *scratch, bool sine) const;
+    void dct3(const T *in, T *out, complex *work, complex *scratch, bool sine) const;
+    void dct4(const T *in, T *out, complex *work, complex *scratch, bool sine) const;
+
+    r2r_kind kind_;
+    int n_;
+    size_t work_; // complex elements staged ahead of the engine's scratch
+
+    std::unique_ptr<rdft<T>> real_;
+    std::unique_ptr<dft<T>> complex_;
+
+    // DCT-II/III: exp(-i pi k / 2n) for k <= n/2. DCT-IV: the pre-twiddle, then the post.
+    memory::table<complex> twiddles_;
+    memory::table<complex> post_;
+};
+
+// howmany row-major multi-dimensional r2r transforms, one kind per axis, over FFTW's
+// advanced-interface layouts (see batch). Computed axis by axis, the contiguous last axis
+// row by row and every other axis in tiles of adjacent columns gathered into scratch. Each
+// transform in a contiguous batch is worked on in out; others are gathered into scratch a
+// transform at a time. With threads > 1 a batch is spread over the pool by transform; a
+// single transform is threaded by row and tile, or inside its engine when 1D.
+template <typename T>
+class r2r_batch {
+  public:
+    using complex = std::complex<T>;
+    using layout = typename batch<T>::layout;
+
+    // Throws std::invalid_argument if kinds and dims differ in length or r2r rejects an axis
+    r2r_batch(const std::vector<int> &dims, const std::vector<r2r_kind> &kinds, int howmany,
+              const layout &in, const layout &out, int threads = 1,
+              rigor effort = rigor::estimate);
+
+    size_t scratch_size() const;
+
+    // Each axis's engine, outermost first, joined by " x "
+    std::string describe() const;
+
+    void execute(const T *in, T *out, complex *scratch) const;
+
+  private:
+    // One contiguous transform, axis by axis: the last from in to data, the rest in place
+    void transform(const T *in, T *data, complex *scratch, int threads) const;
+    void axis(int k, T *data, complex *scratch, int threads) const;
+
+    std::vector<int> dims_;
+    std::vector<std::shared_ptr<const r2r<T>>> axes_;
+    size_t size_; // reals in one transform
+    int howmany_;
+    layout in_;
+    layout out_;
+    int threads_;
+    bool direct_;
+
+    // Element offsets of one transform in each array, only when gathering
+    memory::table<ptrdiff_t> in_offsets_;
+    memory::table<ptrdiff_t> out_offsets_;
+};
+
+extern template class r2r<float>;
+extern template class r2r<double>;
+extern template class r2r_batch<float>;
+extern template class r2r_batch<double>;
+
+} // namespace keyq
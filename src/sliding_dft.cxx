@@ -0,0 +1,177 @@
+#include "../include/sliding_dft.h"
+
+#include <algorithm>
+#include <cmath>
+#include <numbers>
+#include <stdexcept>
+
+namespace keyq {
+
+namespace {
+
+bool valid_bins(std::span<const double> bins, int size) {
+    return std::ranges::all_of(bins, [size](double k) { return k >= 0 && 2 * k <= size; });
+}
+
+// e^(j2πk/N), in double whatever T is
+std::complex<double> rotation(double bin, int size) {
+    return std::polar(1.0, 2 * std::numbers::pi * bin / size);
+}
+
+} // namespace
+
+template <typename T>
+sliding_dft<T>::sliding_dft(std::span<const double> bins, const config &c)
+    : window_(c.window), bins_(bins.begin(), bins.end()), radius_(c.radius) {
+    if (c.window < 2 || !(c.radius > 0 && c.radius <= 1) || !valid_bins(bins, c.window))
+        throw std::invalid_argument(
+            "sliding_dft: needs window >= 2, 0 < radius <= 1 and bins in [0, window/2]");
+
+    history_.assign(window_, T(0));
+    const size_t count = bins_.size();
+    rotate_re_.resize(count);
+    rotate_im_.resize(count);
+    drop_re_.resize(count);
+    drop_im_.resize(count);
+    re_.assign(count, T(0));
+    im_.assign(count, T(0));
+    for (size_t b = 0; b < count; ++b) {
+        const std::complex<double> rotate = radius_ * rotation(bins_[b], window_);
+        const std::complex<double> drop = std::pow(rotate, window_ + 1);
+        rotate_re_[b] = static_cast<T>(rotate.real());
+        rotate_im_[b] = static_cast<T>(rotate.imag());
+        drop_re_[b] = static_cast<T>(drop.real());
+        drop_im_[b] = static_cast<T>(drop.imag());
+        const double turns = bins_[b] - std::floor(bins_[b]);
+        unturn_.push_back(turns == 0 ? complex(1)
+                                     : complex(std::polar(1.0, -2 * std::numbers::pi * turns)));
+    }
+}
+
+template <typename T>
+void sliding_dft<T>::reset() {
+    std::fill(history_.begin(), history_.end(), T(0));
+    std::fill(re_.begin(), re_.end(), T(0));
+    std::fill(im_.begin(), im_.end(), T(0));
+    oldest_ = 0;
+}
+
+template <typename T>
+void sliding_dft<T>::seed(std::span<const T> frame, std::span<const std::complex<T>> spectrum) {
+    if (frame.size() != static_cast<size_t>(window_) ||
+        (!spectrum.empty() && spectrum.size() != static_cast<size_t>(window_ / 2 + 1)))
+        throw std::invalid_argument("sliding_dft: seed needs window samples and window/2+1 bins");
+
+    std::copy(frame.begin(), frame.end(), history_.begin());
+    oldest_ = 0;
+    for (size_t b = 0; b < bins_.size(); ++b) {
+        const double k = bins_[b];
+        std::complex<double> sum;
+        if (!spectrum.empty() && k == std::floor(k)) {
+            sum = spectrum[static_cast<size_t>(k)];
+        } else {
+            // Sum of x[m] (r e^(j2πk/N))^(N-m), by Horner's rule
+            const std::complex<double> rotate = radius_ * rotation(k, window_);
+            for (const T x : frame)
+                sum = (sum + static_cast<double>(x)) * rotate;
+        }
+        re_[b] = static_cast<T>(sum.real());
+        im_[b] = static_cast<T>(sum.imag());
+    }
+}
+
+template <typename T>
+void sliding_dft<T>::push(const T *samples, size_t n) {
+    const size_t count = bins_.size();
+    T *re = re_.data();
+    T *im = im_.data();
+    const T *rotate_re = rotate_re_.data();
+    const T *rotate_im = rotate_im_.data();
+    const T *drop_re = drop_re_.data();
+    const T *drop_im = drop_im_.data();
+
+    for (size_t i = 0; i < n; ++i) {
+        const T x = samples[i];
+        const T old = history_[oldest_];
+        history_[oldest_] = x;
+        if (++oldest_ == history_.size())
+            oldest_ = 0;
+
+        for (size_t b = 0; b < count; ++b) {
+            const T a = re[b] + x;
+            const T c = im[b];
+            re[b] = rotate_re[b] * a - rotate_im[b] * c - drop_re[b] * old;
+            im[b] = rotate_re[b] * c + rotate_im[b] * a - drop_im[b] * old;
+        }
+    }
+}
+
+template <typename T>
+void sliding_dft<T>::values(std::span<complex> out) const {
+    for (size_t b = 0; b < bins_.size(); ++b)
+        out[b] = value(b);
+}
+
+// Reinsch's form of the recurrence s(n) = x(n) + 2 cos ω s(n-1) - s(n-2). Near ω = 0 the plain
+// form loses the signal to rounding, since 2 cos ω is nearly 2 and s grows with a
+// near-cancelling difference; it carries d(n) = s(n) - σ s(n-1) instead, with σ = 1 below a
+// quarter of the sample rate and -1 above, and λ = 2 cos ω - 2σ from sin² or cos² of ω/2 so
+// it keeps its relative precision. Each sample is then
+//     d = x + λ s + σ d,   s = d + σ s
+template <typename T>
+goertzel<T>::goertzel(std::span<const double> bins, int frame_size) : frame_size_(frame_size) {
+    if (frame_size < 2 || !valid_bins(bins, frame_size))
+        throw std::invalid_argument("goertzel: needs frame_size >= 2 and bins in [0, frame/2]");
+
+    // The DFT is e^(-jω(N-1)) s1 - e^(-jωN) s2 for the last two states s1 and s2, and
+    // s2 = σ (s1 - d). So X = e^(-jωN) ((e^(jω) - σ) s + σ d), where e^(-jωN) = e^(-j2πk) is
+    // taken from k's fraction and e^(jω) - σ is 2j sin(ω/2) or 2 cos(ω/2) times e^(jω/2):
+    // from the phases directly, the near-cancelling difference would lose precision.
+    for (const double k : bins) {
+        const double omega = 2 * std::numbers::pi * k / frame_size;
+        const bool low = 4 * k <= frame_size;
+        const double sigma = low ? 1 : -1;
+        // sin(ω/2) below, cos(ω/2) = sin(π(N/2 - k)/N) above, each from a small angle
+        const double away = std::sin(std::numbers::pi * (low ? k : frame_size / 2.0 - k) /
+                                     frame_size);
+        const std::complex<double> turn =
+            std::polar(1.0, -2 * std::numbers::pi * (k - std::floor(k)));
+        const std::complex<double> step =
+            std::polar(2 * away, omega / 2) * (low ? std::complex<double>(0, 1) : 1.0);
+        sign_.push_back(static_cast<T>(sigma));
+        lambda_.push_back(static_cast<T>((low ? -4 : 4) * away * away));
+        weight_s_.push_back(std::complex<T>(turn * step));
+        weight_d_.push_back(std::complex<T>(sigma * turn));
+    }
+    s_.resize(bins.size());
+    d_.resize(bins.size());
+}
+
+template <typename T>
+void goertzel<T>::analyse(const T *frame, std::span<complex> out) {
+    const size_t count = lambda_.size();
+    T *s = s_.data();
+    T *d = d_.data();
+    const T *sign = sign_.data();
+    const T *lambda = lambda_.data();
+    std::fill(s_.begin(), s_.end(), T(0));
+    std::fill(d_.begin(), d_.end(), T(0));
+
+    for (int i = 0; i < frame_size_; ++i) {
+        const T x = frame[i];
+        for (size_t b = 0; b < count; ++b) {
+            d[b] = x + lambda[b] * s[b] + sign[b] * d[b];
+            s[b] = d[b] + sign[b] * s[b];
+        }
+    }
+
+    for (size_t b = 0; b < count; ++b)
+        out[b] = weight_s_[b] * s[b] + weight_d_[b] * d[b];
+}
+
+template class sliding_dft<float>;
+template class sliding_dft<double>;
+template class goertzel<float>;
+template class goertzel<double>;
+
+} // namespace keyq
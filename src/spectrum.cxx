@@ -0,0 +1,152 @@
+#include "../include/spectrum.h"
+
+#include "kernels.h"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+namespace keyq::spectrum {
+
+namespace {
+
+template <typename T>
+const T *interleaved(std::span<const std::complex<T>> bins) {
+    return reinterpret_cast<const T *>(bins.data());
+}
+
+template <typename T>
+size_t find(std::span<const T> s, T threshold, std::span<peak<T>> out) {
+    size_t found = 0;
+    for (size_t i = 1; i + 1 < s.size(); ++i) {
+        const T a = s[i - 1];
+        const T b = s[i];
+        const T c = s[i + 1];
+        if (!(b > threshold && b > a && b >= c))
+            continue;
+
+        // Vertex of the parabola through the three points
+        const T curve = a - 2 * b + c;
+        const T offset = curve < 0 ? T(0.5) * (a - c) / curve : T(0);
+        const peak<T> p{static_cast<double>(i) + offset, b - T(0.25) * (a - c) * offset};
+
+        // Keep out sorted, strongest first, dropping the weakest once it's full
+        size_t at = found;
+        while (at > 0 && out[at - 1].value < p.value)
+            --at;
+        if (at == out.size())
+            continue;
+        if (found < out.size())
+            ++found;
+        std::move_backward(out.begin() + at, out.begin() + found - 1, out.begin() + found);
+        out[at] = p;
+    }
+    return found;
+}
+
+} // namespace
+
+void power(std::span<const std::complex<float>> bins, std::span<float> out, float scale) {
+    simd::best<float>().power(interleaved(bins), out.data(), bins.size(), scale);
+}
+
+void power(std::span<const std::complex<double>> bins, std::span<double> out, double scale) {
+    simd::best<double>().power(interleaved(bins), out.data(), bins.size(), scale);
+}
+
+void decibels(std::span<const float> power, std::span<float> out, float floor) {
+    simd::best<float>().decibels(power.data(), out.data(), power.size(), floor);
+}
+
+void decibels(std::span<const double> power, std::span<double> out, double floor) {
+    simd::best<double>().decibels(power.data(), out.data(), power.size(), floor);
+}
+
+void power_db(std::span<const std::complex<float>> bins, std::span<float> out, float scale,
+              float floor) {
+    simd::best<float>().power_db(interleaved(bins), out.data(), bins.size(), scale, floor);
+}
+
+void power_db(std::span<const std::complex<double>> bins, std::span<double> out, double scale,
+              double floor) {
+    simd::best<double>().power_db(interleaved(bins), out.data(), bins.size(), scale, floor);
+}
+
+void smooth(std::span<const float> in, std::span<float> state, float attack, float release) {
+    simd::best<float>().smooth(in.data(), state.data(), in.size(), attack, release);
+}
+
+void smooth(std::span<const double> in, std::span<double> state, double attack,
+            double release) {
+    simd::best<double>().smooth(in.data(), state.data(), in.size(), attack, release);
+}
+
+size_t find_peaks(std::span<const float> spectrum, float threshold,
+                  std::span<peak<float>> out) {
+    return find(spectrum, threshold, out);
+}
+
+size_t find_peaks(std::span<const double> spectrum, double threshold,
+                  std::span<peak<double>> out) {
+    return find(spectrum, threshold, out);
+}
+
+template <typename T>
+log_bins<T>::log_bins(const config &c)
+    : how_(c.how), bins_(static_cast<size_t>(c.fft_size / 2 + 1)) {
+    if (c.fft_size < 2 || c.bands < 1 || !(c.low > 0) || !(c.low < c.high))
+        throw std::invalid_argument("log_bins: needs fft_size >= 2, bands >= 1, 0 < low < high");
+
+    // Edges in bins, spaced evenly in log frequency
+    const double per_hz = c.fft_size / c.sample_rate;
+    const double high = std::min(c.high, c.sample_rate / 2);
+    const double ratio = high / c.low;
+    const auto edge = [&](int b) { return c.low * std::pow(ratio, double(b) / c.bands) * per_hz; };
+
+    const int last = static_cast<int>(bins_) - 1;
+    for (int b = 0; b < c.bands; ++b) {
+        const double lower = edge(b);
+        const double upper = edge(b + 1);
+        const double middle = std::sqrt(lower * upper);
+        centre_.push_back(middle / per_hz);
+
+        // Bins k with lower <= k < upper
+        const int first = std::clamp(static_cast<int>(std::ceil(lower)), 0, last);
+        const int end = std::clamp(static_cast<int>(std::ceil(upper)), 0, last + 1);
+        if (end > first) {
+            first_.push_back(first);
+            count_.push_back(end - first);
+            weight_.push_back(T(0));
+        } else {
+            const int below = std::clamp(static_cast<int>(middle), 0, std::max(last - 1, 0));
+            first_.push_back(below);
+            count_.push_back(0);
+            weight_.push_back(static_cast<T>(std::clamp(middle - below, 0.0, 1.0)));
+        }
+    }
+}
+
+template <typename T>
+void log_bins<T>::map(std::span<const T> spectrum, std::span<T> out) const {
+    const T *s = spectrum.data();
+    for (size_t b = 0; b < first_.size(); ++b) {
+        const T *x = s + first_[b];
+        const int n = count_[b];
+        if (n == 0) {
+            const T next = bins_ > 1 ? x[1] : x[0];
+            out[b] = x[0] + weight_[b] * (next - x[0]);
+        } else if (how_ == reduce::max) {
+            out[b] = *std::max_element(x, x + n);
+        } else {
+            T sum = 0;
+            for (int k = 0; k < n; ++k)
+                sum += x[k];
+            out[b] = sum / n;
+        }
+    }
+}
+
+template class log_bins<float>;
+template class log_bins<double>;
+
+} // namespace keyq::spectrum
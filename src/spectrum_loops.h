@@ -0,0 +1,90 @@
+#pragma once
+
+#include <bit>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <numbers>
+#include <type_traits>
+
+// Spectrum post-processing loops, compiled into every kernel set like the butterflies. They
+// are plain loops with no calls or branches the vectoriser can't turn into selects, so each
+// kernels_*.cxx file gets them at its own vector width from its target flags.
+
+namespace keyq::simd {
+namespace {
+
+// 10 log10(x) for finite x > 0, without calling log. With x = m 2^e and m in [sqrt(1/2),
+// sqrt(2)), ln m is the atanh series 2(s + s^3/3 + s^5/5 + s^7/7) in s = (m - 1)/(m + 1);
+// |s| < 0.172, so the first term left out is below 3e-8 and the result is within 2e-7 dB
+// of exact before rounding to T.
+template <typename T>
+[[gnu::always_inline]] inline T fast_decibels(T x) {
+    using bits = std::conditional_t<sizeof(T) == 4, uint32_t, uint64_t>;
+    using sbits = std::make_signed_t<bits>;
+    constexpr int mantissa = std::numeric_limits<T>::digits - 1;
+    constexpr bits low = std::bit_cast<bits>(static_cast<T>(std::numbers::sqrt2 / 2));
+
+    // Offsetting by sqrt(1/2) puts the exponent step at the bottom of m's range
+    const bits offset = std::bit_cast<bits>(x) - low;
+    const T e = static_cast<T>(static_cast<sbits>(offset) >> mantissa);
+    const T m = std::bit_cast<T>((offset & ((bits{1} << mantissa) - 1)) + low);
+
+    const T s = (m - 1) / (m + 1);
+    const T s2 = s * s;
+    const T ln_m = 2 * s * (1 + s2 * (T(1) / 3 + s2 * (T(1) / 5 + s2 * (T(1) / 7))));
+    constexpr T db_per_ln = static_cast<T>(10 / std::numbers::ln10);
+    return db_per_ln * (e * static_cast<T>(std::numbers::ln2) + ln_m);
+}
+
+// Smallest input that maps above floor dB; anything below it, zero and NaN included, gives
+// floor
+template <typename T>
+T floor_power(T floor) {
+    return static_cast<T>(std::pow(10.0, floor / 10.0));
+}
+
+// out = |x|^2 scale for n interleaved complex bins
+template <typename T>
+void power_loop(const T *bins, T *out, size_t n, T scale) {
+    for (size_t i = 0; i < n; ++i) {
+        const T re = bins[2 * i];
+        const T im = bins[2 * i + 1];
+        out[i] = (re * re + im * im) * scale;
+    }
+}
+
+template <typename T>
+void decibels_loop(const T *power, T *out, size_t n, T floor) {
+    const T tiny = floor_power(floor);
+    for (size_t i = 0; i < n; ++i) {
+        const T p = power[i] > tiny ? power[i] : tiny;
+        out[i] = fast_decibels(p);
+    }
+}
+
+// The two above in one pass, so the power never goes to memory
+template <typename T>
+void power_db_loop(const T *bins, T *out, size_t n, T scale, T floor) {
+    const T tiny = floor_power(floor);
+    for (size_t i = 0; i < n; ++i) {
+        const T re = bins[2 * i];
+        const T im = bins[2 * i + 1];
+        const T p = (re * re + im * im) * scale;
+        out[i] = fast_decibels(p > tiny ? p : tiny);
+    }
+}
+
+// One-pole smoothing with separate rise and fall rates: state moves that fraction of the way
+// to the input each frame
+template <typename T>
+void smooth_loop(const T *in, T *state, size_t n, T attack, T release) {
+    for (size_t i = 0; i < n; ++i) {
+        const T gap = in[i] - state[i];
+        state[i] += gap * (gap > 0 ? attack : release);
+    }
+}
+
+} // namespace
+} // namespace keyq::simd
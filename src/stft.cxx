@@ -0,0 +1,90 @@
+#include "../include/stft.h"
+
+#include "dft.h"
+#include "window.h"
+
+#include <algorithm>
+#include <cmath>
+#include <numbers>
+#include <stdexcept>
+
+namespace keyq {
+
+template <typename T>
+std::vector<T> make_window(window kind, int n) {
+    std::vector<T> w(n);
+    for (int i = 0; i < n; ++i) {
+        const double x = 2 * std::numbers::pi * i / n;
+        switch (kind) {
+            case window::rectangular:
+                w[i] = T(1);
+                break;
+            case window::hann:
+                w[i] = static_cast<T>(0.5 - 0.5 * std::cos(x));
+                break;
+            case window::hamming:
+                w[i] = static_cast<T>(0.54 - 0.46 * std::cos(x));
+                break;
+            case window::blackman:
+                w[i] = static_cast<T>(0.42 - 0.5 * std::cos(x) + 0.08 * std::cos(2 * x));
+                break;
+        }
+    }
+    return w;
+}
+
+template <typename T>
+stft<T>::stft(const config &c) : frame_size_(c.frame_size), hop_(c.hop) {
+    if (c.frame_size < 2 || c.hop < 1)
+        throw std::invalid_argument("stft: frame_size must be at least 2 and hop at least 1");
+
+    window_ = make_window<T>(c.window, frame_size_);
+    ring_.assign(2 * static_cast<size_t>(frame_size_), T(0));
+    frame_.resize(frame_size_);
+    spectrum_.resize(bins());
+    engine_ = std::make_unique<const rdft<T>>(frame_size_, -1);
+    scratch_.resize(engine_->scratch_size());
+}
+
+template <typename T>
+stft<T>::~stft() = default;
+
+template <typename T>
+void stft<T>::reset() {
+    std::fill(ring_.begin(), ring_.end(), T(0));
+    std::fill(spectrum_.begin(), spectrum_.end(), complex{});
+    write_ = 0;
+    pending_ = 0;
+}
+
+template <typename T>
+size_t stft<T>::fill(const T *samples, size_t n) {
+    const size_t size = frame_size_;
+    const size_t count = std::min(n, static_cast<size_t>(hop_) - pending_);
+    for (size_t i = 0; i < count; ++i) {
+        ring_[write_] = ring_[write_ + size] = samples[i];
+        if (++write_ == size)
+            write_ = 0;
+    }
+    pending_ += count;
+    return count;
+}
+
+// The newest frame_size samples start at write_ and run on into the mirror
+template <typename T>
+const std::vector<typename stft<T>::complex> &stft<T>::analyse() {
+    pending_ = 0;
+    const T *newest = ring_.data() + write_;
+    for (int i = 0; i < frame_size_; ++i)
+        frame_[i] = newest[i] * window_[i];
+    engine_->forward(frame_.data(), spectrum_.data(), scratch_.data());
+    return spectrum_;
+}
+
+template std::vector<float> make_window(window, int);
+template std::vector<double> make_window(window, int);
+
+template class stft<float>;
+template class stft<double>;
+
+} // namespace keyq
@@ -0,0 +1,158 @@
+#include "thread_pool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace keyq::pool {
+
+namespace {
+
+struct job {
+    task fn;
+    void *context;
+    std::atomic<size_t> remaining; // chunks not yet finished
+};
+
+struct chunk {
+    job *owner;
+    size_t begin;
+    size_t end;
+};
+
+struct queue {
+    std::mutex mutex;
+    std::deque<chunk> chunks;
+};
+
+struct state {
+    std::mutex mutex; // guards sleeping workers and resizing
+    std::condition_variable wake;
+    std::vector<std::unique_ptr<queue>> queues; // one per worker
+    std::vector<std::thread> workers;
+    std::atomic<size_t> pending{0}; // chunks queued but not yet taken
+    bool stopping = false;
+
+    ~state() { stop(); }
+
+    void stop() {
+        {
+            std::lock_guard lock(mutex);
+            stopping = true;
+        }
+        wake.notify_all();
+        for (auto &t : workers)
+            t.join();
+        workers.clear();
+        queues.clear();
+        stopping = false;
+    }
+};
+
+state &shared() {
+    static state s;
+    return s;
+}
+
+constexpr size_t no_owner = static_cast<size_t>(-1);
+
+// Pop from the back of our own deque, else steal from the front of the others
+bool take(state &s, size_t self, chunk &out) {
+    const size_t count = s.queues.size();
+    const size_t start = self == no_owner ? 0 : self;
+    for (size_t i = 0; i < count; ++i) {
+        queue &q = *s.queues[(start + i) % count];
+        std::lock_guard lock(q.mutex);
+        if (q.chunks.empty())
+            continue;
+        if (i == 0 && self != no_owner) {
+            out = q.chunks.back();
+            q.chunks.pop_back();
+        } else {
+            out = q.chunks.front();
+            q.chunks.pop_front();
+        }
+        s.pending.fetch_sub(1, std::memory_order_relaxed);
+        return true;
+    }
+    return false;
+}
+
+// The decrement is the last touch of the job: its owner may return as soon as it sees zero
+void finish(const chunk &c) {
+    c.owner->fn(c.owner->context, c.begin, c.end);
+    c.owner->remaining.fetch_sub(1, std::memory_order_acq_rel);
+}
+
+void work(state &s, size_t self) {
+    for (;;) {
+        chunk c;
+        if (take(s, self, c)) {
+            finish(c);
+            continue;
+        }
+        std::unique_lock lock(s.mutex);
+        s.wake.wait(lock, [&] { return s.stopping || s.pending.load() > 0; });
+        if (s.stopping)
+            return;
+    }
+}
+
+} // namespace
+
+void resize(int workers) {
+    state &s = shared();
+    const size_t wanted = static_cast<size_t>(std::max(workers, 0));
+    if (wanted == s.workers.size())
+        return;
+
+    s.stop();
+    for (size_t i = 0; i < wanted; ++i)
+        s.queues.push_back(std::make_unique<queue>());
+    for (size_t i = 0; i < wanted; ++i)
+        s.workers.emplace_back(work, std::ref(s), i);
+}
+
+int size() {
+    return static_cast<int>(shared().workers.size());
+}
+
+void run(int threads, size_t count, task fn, void *context) {
+    state &s = shared();
+    const size_t helpers = std::min(static_cast<size_t>(threads - 1), s.queues.size());
+    if (helpers == 0 || count <= 1) {
+        fn(context, 0, count);
+        return;
+    }
+
+    // A few chunks per thread so a slow one can be balanced by stealing
+    const size_t chunks = std::min(count, 4 * (helpers + 1));
+    job j{fn, context, {chunks}};
+    // Counted before they're published, so a worker taking one can't wrap the count below 0
+    s.pending.fetch_add(chunks);
+    for (size_t c = 0; c < chunks; ++c) {
+        queue &q = *s.queues[c % helpers];
+        std::lock_guard lock(q.mutex);
+        q.chunks.push_back({&j, count * c / chunks, count * (c + 1) / chunks});
+    }
+    {
+        std::lock_guard lock(s.mutex);
+    }
+    s.wake.notify_all();
+
+    // Help until our own chunks are all done, yielding while the last ones finish elsewhere
+    while (j.remaining.load(std::memory_order_acquire) != 0) {
+        chunk c;
+        if (take(s, no_owner, c))
+            finish(c);
+        else
+            std::this_thread::yield();
+    }
+}
+
+} // namespace keyq::pool
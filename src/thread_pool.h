@@ -0,0 +1,38 @@
+#pragma once
+
+#include <cstddef>
+#include <type_traits>
+
+// Persistent work-stealing thread pool shared by every plan. parallel_for splits an index
+// range into chunks dealt round-robin onto per-worker deques; each worker drains its own
+// deque from the back and steals from the front of the others when it runs dry, and the
+// calling thread joins in until its own job is finished.
+namespace keyq::pool {
+
+// Start or stop threads so the pool has this many workers; 0 joins them all. Like FFTW's
+// thread setup calls, not safe while any transform is executing.
+void resize(int workers);
+
+int size();
+
+using task = void (*)(void *context, size_t begin, size_t end);
+
+// Run fn over [0, count) on up to threads threads, the caller included. Blocks until done.
+void run(int threads, size_t count, task fn, void *context);
+
+template <typename F>
+void parallel_for(int threads, size_t count, F &&body) {
+    if (threads <= 1 || count <= 1) {
+        body(size_t{0}, count);
+        return;
+    }
+    using body_t = std::remove_reference_t<F>;
+    run(
+        threads, count,
+        [](void *context, size_t begin, size_t end) {
+            (*static_cast<body_t *>(context))(begin, end);
+        },
+        const_cast<void *>(static_cast<const void *>(&body)));
+}
+
+} // namespace keyq::pool
@@ -0,0 +1,13 @@
+#pragma once
+
+#include "../include/stft.h"
+
+#include <vector>
+
+namespace keyq {
+
+// Periodic window of length n, computed in double
+template <typename T>
+std::vector<T> make_window(window kind, int n);
+
+} // namespace keyq
@@ -0,0 +1,109 @@
+// The convolver against direct convolution in long double: responses shorter than a block,
+// a whole number of blocks and ragged, uniform and non-uniform partitions, block sizes that
+// aren't powers of two, in-place blocks and reset.
+#include "convolver.h"
+
+#include "reference.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <print>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+int failures = 0;
+
+void expect(double error, double limit, const std::string &what) {
+    if (error <= limit)
+        return;
+    std::println(stderr, "{}: error {:.3g} over {:.0e}", what, error, limit);
+    ++failures;
+}
+
+std::mt19937 random_source(2024);
+
+template <typename T>
+std::vector<T> noise(size_t n) {
+    std::uniform_real_distribution<double> value(-1, 1);
+    std::vector<T> x(n);
+    for (auto &v : x)
+        v = static_cast<T>(value(random_source));
+    return x;
+}
+
+// Output sample i of x convolved with h, x being zero past its end
+template <typename T>
+long double direct(const std::vector<T> &x, const std::vector<T> &h, size_t i) {
+    long double sum = 0;
+    for (size_t j = 0; j < h.size() && j <= i; ++j)
+        sum += static_cast<long double>(h[j]) * x[i - j];
+    return sum;
+}
+
+// Enough blocks of noise to run through the whole response and then some, streamed through
+// out of place, then again in place after a reset
+template <typename T>
+double run(size_t length, const typename keyq::convolver<T>::config &c) {
+    const std::vector<T> h = noise<T>(length);
+    keyq::convolver<T> convolver(h, c);
+    const size_t block = static_cast<size_t>(c.block_size);
+    const size_t blocks = (length + block - 1) / block + 3;
+    const std::vector<T> x = noise<T>(blocks * block);
+
+    reference::error e;
+    std::vector<T> out(block);
+    for (size_t b = 0; b < blocks; ++b) {
+        convolver.process(x.data() + b * block, out.data());
+        for (size_t i = 0; i < block; ++i)
+            e.add(direct(x, h, b * block + i), out[i]);
+    }
+
+    convolver.reset();
+    std::vector<T> buffer(x);
+    for (size_t b = 0; b < blocks; ++b) {
+        T *io = buffer.data() + b * block;
+        convolver.process(io, io);
+        for (size_t i = 0; i < block; ++i)
+            e.add(direct(x, h, b * block + i), io[i]);
+    }
+    return e.relative();
+}
+
+template <typename T>
+void lengths(double tolerance, const char *type) {
+    struct setup {
+        size_t length;
+        int block_size;
+        bool non_uniform;
+    };
+    const setup setups[] = {
+        {1, 64, false},     {7, 64, false},    {64, 64, false},  {200, 64, false},
+        {1000, 256, false}, {1000, 100, false}, {37, 1, false},  {5000, 64, true},
+        {9000, 32, true},   {300, 96, true},
+    };
+    for (const setup &s : setups) {
+        typename keyq::convolver<T>::config c;
+        c.block_size = s.block_size;
+        c.non_uniform = s.non_uniform;
+        c.max_block_size = 1024;
+        expect(run<T>(s.length, c), tolerance,
+               std::string(type) + " response " + std::to_string(s.length) + " block " +
+                   std::to_string(s.block_size) + (s.non_uniform ? " non-uniform" : ""));
+    }
+}
+
+} // namespace
+
+int main() {
+    lengths<double>(1e-11, "double");
+    lengths<float>(1e-4, "float");
+
+    if (failures) {
+        std::println(stderr, "{} convolutions disagree with the direct sum", failures);
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
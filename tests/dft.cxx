@@ -0,0 +1,319 @@
+// Complex and real-input DFTs through the FFTW API against a direct long double DFT: 1D at
+// powers of two, mixed radices, primes and audio frame sizes (Bluestein past the largest
+// radix), r2c/c2r out of place and padded in place, N-D, and batches of both through the
+// advanced interface with strided and padded layouts. Backward transforms are normalised by
+// 1/N, so they're compared against the reference scaled to match.
+#include "keyq.h"
+
+#include "reference.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <limits>
+#include <print>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+using complex = std::complex<double>;
+
+constexpr double tolerance = 1e-11;
+constexpr double float_tolerance = 1e-4;
+constexpr double failed = std::numeric_limits<double>::infinity();
+
+int failures = 0;
+
+void expect(double error, double limit, const std::string &what) {
+    if (error <= limit)
+        return;
+    std::println(stderr, "{}: error {:.3g} over {:.0e}", what, error, limit);
+    ++failures;
+}
+
+std::mt19937 random_source(2024);
+
+std::vector<complex> noise(size_t n) {
+    std::uniform_real_distribution<double> value(-1, 1);
+    std::vector<complex> x(n);
+    for (auto &v : x)
+        v = {value(random_source), value(random_source)};
+    return x;
+}
+
+std::vector<double> real_noise(size_t n) {
+    std::uniform_real_distribution<double> value(-1, 1);
+    std::vector<double> x(n);
+    for (auto &v : x)
+        v = value(random_source);
+    return x;
+}
+
+fftw_complex *as_fftw(complex *p) {
+    return reinterpret_cast<fftw_complex *>(p);
+}
+
+long double normalisation(long long n, int sign) {
+    return sign == FFTW_BACKWARD ? 1.0L / n : 1.0L;
+}
+
+// Row-major N-D DFT of x, one axis at a time
+std::vector<reference::complex> transform(const std::vector<int> &dims,
+                                          std::vector<reference::complex> x, int sign) {
+    long long inner = 1;
+    for (size_t axis = dims.size(); axis-- > 0;) {
+        const long long n = dims[axis];
+        const long long outer = static_cast<long long>(x.size()) / (n * inner);
+        const reference::dft direct(n, sign);
+        std::vector<reference::complex> line(static_cast<size_t>(n));
+        for (long long o = 0; o < outer; ++o)
+            for (long long i = 0; i < inner; ++i) {
+                const reference::complex *first = x.data() + o * n * inner + i;
+                for (long long k = 0; k < n; ++k)
+                    line[k] = direct.bin(first, k, inner);
+                for (long long k = 0; k < n; ++k)
+                    x[(o * n + k) * inner + i] = line[k];
+            }
+        inner *= n;
+    }
+    return x;
+}
+
+double c2c(int n, int sign, bool in_place) {
+    const std::vector<complex> x = noise(n);
+    std::vector<complex> buffer = x;
+    std::vector<complex> out(in_place ? 0 : n);
+    complex *result = in_place ? buffer.data() : out.data();
+    fftw_plan p = fftw_plan_dft_1d(n, as_fftw(buffer.data()), as_fftw(result), sign, FFTW_ESTIMATE);
+    if (!p)
+        return failed;
+    fftw_execute(p);
+    fftw_destroy_plan(p);
+
+    const reference::dft direct(n, sign);
+    reference::error e;
+    for (long long k : reference::bins(n))
+        e.add(direct.bin(x.data(), k) * normalisation(n, sign), reference::complex(result[k]));
+    return e.relative();
+}
+
+double c2c_float(int n, int sign) {
+    const std::vector<complex> x = noise(n);
+    std::vector<std::complex<float>> in(x.begin(), x.end()), out(n);
+    fftwf_plan p = fftwf_plan_dft_1d(n, reinterpret_cast<fftwf_complex *>(in.data()),
+                                     reinterpret_cast<fftwf_complex *>(out.data()), sign,
+                                     FFTW_ESTIMATE);
+    if (!p)
+        return failed;
+    fftwf_execute(p);
+    fftwf_destroy_plan(p);
+
+    const reference::dft direct(n, sign);
+    reference::error e;
+    for (long long k : reference::bins(n))
+        e.add(direct.bin(in.data(), k) * normalisation(n, sign), reference::complex(out[k]));
+    return e.relative();
+}
+
+// r2c against the reference, then c2r back to the input. In place, the reals sit in an array
+// of 2 (n/2 + 1) that the spectrum then fills, as FFTW lays it out.
+double r2c(int n, bool in_place) {
+    const long long half = n / 2 + 1;
+    const std::vector<double> x = real_noise(n);
+    std::vector<double> buffer(in_place ? 2 * half : n);
+    std::vector<complex> out(in_place ? 0 : half);
+    complex *spectrum = in_place ? reinterpret_cast<complex *>(buffer.data()) : out.data();
+    fftw_plan forward = fftw_plan_dft_r2c_1d(n, buffer.data(), as_fftw(spectrum), FFTW_ESTIMATE);
+    fftw_plan backward = fftw_plan_dft_c2r_1d(n, as_fftw(spectrum), buffer.data(), FFTW_ESTIMATE);
+    if (!forward || !backward)
+        return failed;
+    std::copy(x.begin(), x.end(), buffer.begin());
+    fftw_execute(forward);
+
+    const reference::dft direct(n, FFTW_FORWARD);
+    reference::error e;
+    for (long long k : reference::bins(n))
+        if (k < half)
+            e.add(direct.bin(x.data(), k), reference::complex(spectrum[k]));
+
+    fftw_execute(backward);
+    reference::error round_trip;
+    for (int i = 0; i < n; ++i)
+        round_trip.add(x[i], buffer[i]);
+    fftw_destroy_plan(forward);
+    fftw_destroy_plan(backward);
+    return std::max(e.relative(), round_trip.relative());
+}
+
+double r2c_float(int n) {
+    const long long half = n / 2 + 1;
+    const std::vector<double> x = real_noise(n);
+    std::vector<float> in(x.begin(), x.end());
+    std::vector<std::complex<float>> out(half);
+    fftwf_plan p = fftwf_plan_dft_r2c_1d(n, in.data(), reinterpret_cast<fftwf_complex *>(out.data()),
+                                         FFTW_ESTIMATE);
+    if (!p)
+        return failed;
+    fftwf_execute(p);
+    fftwf_destroy_plan(p);
+
+    const reference::dft direct(n, FFTW_FORWARD);
+    reference::error e;
+    for (long long k : reference::bins(n))
+        if (k < half)
+            e.add(direct.bin(in.data(), k), reference::complex(out[k]));
+    return e.relative();
+}
+
+double nd(const std::vector<int> &dims, int sign) {
+    long long total = 1;
+    for (int d : dims)
+        total *= d;
+    const std::vector<complex> x = noise(total);
+    std::vector<complex> in = x, out(total);
+    fftw_plan p = fftw_plan_dft(static_cast<int>(dims.size()), dims.data(), as_fftw(in.data()),
+                                as_fftw(out.data()), sign, FFTW_ESTIMATE);
+    if (!p)
+        return failed;
+    fftw_execute(p);
+    fftw_destroy_plan(p);
+
+    const auto want = transform(dims, {x.begin(), x.end()}, sign);
+    reference::error e;
+    for (long long i = 0; i < total; ++i)
+        e.add(want[i] * normalisation(total, sign), reference::complex(out[i]));
+    return e.relative();
+}
+
+// howmany r2c transforms of n through fftw_plan_many_dft_r2c, each element stride apart and
+// each transform dist reals or bins apart, then c2r back
+double many_r2c(int n, int howmany, int stride, int real_dist, int complex_dist) {
+    const int half = n / 2 + 1;
+    const std::vector<double> x =
+        real_noise(static_cast<size_t>((howmany - 1) * real_dist + (n - 1) * stride + 1));
+    std::vector<double> in = x;
+    std::vector<complex> out(static_cast<size_t>((howmany - 1) * complex_dist +
+                                                 (half - 1) * stride + 1));
+    fftw_plan forward = fftw_plan_many_dft_r2c(1, &n, howmany, in.data(), nullptr, stride,
+                                               real_dist, as_fftw(out.data()), nullptr, stride,
+                                               complex_dist, FFTW_ESTIMATE);
+    fftw_plan backward = fftw_plan_many_dft_c2r(1, &n, howmany, as_fftw(out.data()), nullptr,
+                                                stride, complex_dist, in.data(), nullptr, stride,
+                                                real_dist, FFTW_ESTIMATE);
+    if (!forward || !backward)
+        return failed;
+    fftw_execute(forward);
+
+    const reference::dft direct(n, FFTW_FORWARD);
+    reference::error e, round_trip;
+    for (int b = 0; b < howmany; ++b)
+        for (int k = 0; k < half; ++k)
+            e.add(direct.bin(x.data() + b * real_dist, k, stride),
+                  reference::complex(out[b * complex_dist + k * stride]));
+
+    fftw_execute(backward);
+    for (int b = 0; b < howmany; ++b)
+        for (int i = 0; i < n; ++i)
+            round_trip.add(x[b * real_dist + i * stride], in[b * real_dist + i * stride]);
+    fftw_destroy_plan(forward);
+    fftw_destroy_plan(backward);
+    return std::max(e.relative(), round_trip.relative());
+}
+
+// howmany transforms of dims, each element stride apart and each transform dist apart, in
+// and out alike
+double many(const std::vector<int> &dims, int howmany, int stride, int dist, int sign) {
+    long long total = 1;
+    for (int d : dims)
+        total *= d;
+    const size_t length = static_cast<size_t>((howmany - 1) * dist + (total - 1) * stride + 1);
+    const std::vector<complex> x = noise(length);
+    std::vector<complex> in = x, out(length);
+    fftw_plan p = fftw_plan_many_dft(static_cast<int>(dims.size()), dims.data(), howmany,
+                                     as_fftw(in.data()), nullptr, stride, dist,
+                                     as_fftw(out.data()), nullptr, stride, dist, sign,
+                                     FFTW_ESTIMATE);
+    if (!p)
+        return failed;
+    fftw_execute(p);
+    fftw_destroy_plan(p);
+
+    reference::error e;
+    std::vector<reference::complex> batch(static_cast<size_t>(total));
+    for (int b = 0; b < howmany; ++b) {
+        for (long long i = 0; i < total; ++i)
+            batch[i] = reference::complex(x[b * dist + i * stride]);
+        const auto want = transform(dims, batch, sign);
+        for (long long i = 0; i < total; ++i)
+            e.add(want[i] * normalisation(total, sign),
+                  reference::complex(out[b * dist + i * stride]));
+    }
+    return e.relative();
+}
+
+void one_dimensional(const std::string &threads) {
+    const int sizes[] = {1,   2,   3,   4,   5,    6,    7,    8,    9,    11,    12,    13,
+                         15,  16,  17,  25,  27,   30,   32,   49,   60,   64,    97,    100,
+                         121, 125, 128, 210, 243,  256,  360,  480,  512,  960,   1000,  1009,
+                         1024, 2048, 4096, 4099, 4800, 44100, 48000, 65536};
+    for (int n : sizes) {
+        const std::string size = " n " + std::to_string(n) + threads;
+        expect(c2c(n, FFTW_FORWARD, false), tolerance, "c2c forward" + size);
+        expect(c2c(n, FFTW_BACKWARD, false), tolerance, "c2c backward" + size);
+        expect(c2c(n, FFTW_FORWARD, true), tolerance, "c2c in place" + size);
+        expect(r2c(n, false), tolerance, "r2c/c2r" + size);
+        expect(r2c(n, true), tolerance, "r2c/c2r padded in place" + size);
+    }
+}
+
+void multi_dimensional(const std::string &threads) {
+    const std::vector<std::vector<int>> shapes = {
+        {8, 12}, {17, 6}, {1, 30}, {45, 48}, {4, 6, 5}, {3, 17, 8}, {2, 3, 4, 5}};
+    for (const auto &dims : shapes) {
+        std::string shape;
+        for (int d : dims)
+            shape += (shape.empty() ? " " : "x") + std::to_string(d);
+        expect(nd(dims, FFTW_FORWARD), tolerance, "N-D forward" + shape + threads);
+        expect(nd(dims, FFTW_BACKWARD), tolerance, "N-D backward" + shape + threads);
+    }
+    expect(many_r2c(64, 4, 1, 64, 33), tolerance, "many r2c contiguous" + threads);
+    expect(many_r2c(10, 3, 1, 12, 6), tolerance, "many r2c padded" + threads);
+    expect(many_r2c(32, 16, 16, 1, 1), tolerance, "many r2c interleaved" + threads);
+    expect(many_r2c(15, 7, 7, 1, 1), tolerance, "many r2c interleaved odd" + threads);
+
+    expect(many({64}, 5, 1, 64, FFTW_FORWARD), tolerance, "many contiguous" + threads);
+    expect(many({16}, 13, 13, 1, FFTW_FORWARD), tolerance, "many interleaved" + threads);
+    expect(many({97}, 9, 9, 1, FFTW_BACKWARD), tolerance, "many interleaved prime" + threads);
+    expect(many({12}, 3, 1, 20, FFTW_FORWARD), tolerance, "many padded" + threads);
+    expect(many({8}, 4, 2, 17, FFTW_BACKWARD), tolerance, "many strided" + threads);
+    expect(many({8, 5}, 10, 10, 1, FFTW_FORWARD), tolerance, "many 2D interleaved" + threads);
+}
+
+} // namespace
+
+int main() {
+    one_dimensional("");
+    multi_dimensional("");
+
+    for (int n : {8, 17, 60, 1009, 4096, 44100}) {
+        const std::string size = " n " + std::to_string(n);
+        expect(c2c_float(n, FFTW_FORWARD), float_tolerance, "float c2c forward" + size);
+        expect(c2c_float(n, FFTW_BACKWARD), float_tolerance, "float c2c backward" + size);
+        expect(r2c_float(n), float_tolerance, "float r2c" + size);
+    }
+
+    // Again with plans split across threads: four-step 1D, N-D and batches
+    fftw_init_threads();
+    fftw_plan_with_nthreads(4);
+    one_dimensional(", 4 threads");
+    multi_dimensional(", 4 threads");
+    fftw_cleanup_threads();
+
+    if (failures) {
+        std::println(stderr, "{} transforms disagree with the direct DFT", failures);
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,180 @@
+// Every r2r kind through fftw_plan_r2r_1d against the direct sums FFTW defines them by, in
+// long double: R2HC, HC2R, DHT and the eight DCTs and DSTs, in and out of place, double and
+// float, then 2D kinds per axis and a batch through fftw_plan_many_r2r. Like FFTW, r2r
+// transforms aren't normalised, so the reference isn't either.
+#include "keyq.h"
+
+#include "reference.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <print>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+constexpr double tolerance = 1e-11;
+constexpr double float_tolerance = 1e-4;
+
+const char *const names[] = {"R2HC",    "HC2R",    "DHT",     "REDFT00", "REDFT01", "REDFT10",
+                             "REDFT11", "RODFT00", "RODFT01", "RODFT10", "RODFT11"};
+
+int failures = 0;
+
+void expect(double error, double limit, const std::string &what) {
+    if (error <= limit)
+        return;
+    std::println(stderr, "{}: error {:.3g} over {:.0e}", what, error, limit);
+    ++failures;
+}
+
+std::mt19937 random_source(2024);
+
+std::vector<double> noise(size_t n) {
+    std::uniform_real_distribution<double> value(-1, 1);
+    std::vector<double> x(n);
+    for (auto &v : x)
+        v = value(random_source);
+    return x;
+}
+
+template <typename V>
+double difference(const std::vector<long double> &want, const V *got) {
+    reference::error e;
+    for (size_t i = 0; i < want.size(); ++i)
+        e.add(want[i], got[i]);
+    return e.relative();
+}
+
+// Along one axis of a row-major array, in place
+void along(std::vector<long double> &x, const std::vector<int> &dims, size_t axis, int kind) {
+    long long inner = 1;
+    for (size_t d = axis + 1; d < dims.size(); ++d)
+        inner *= dims[d];
+    const long long n = dims[axis];
+    const long long outer = static_cast<long long>(x.size()) / (n * inner);
+    std::vector<long double> line(static_cast<size_t>(n));
+    for (long long o = 0; o < outer; ++o)
+        for (long long i = 0; i < inner; ++i) {
+            for (long long j = 0; j < n; ++j)
+                line[j] = x[(o * n + j) * inner + i];
+            line = reference::r2r(kind, line);
+            for (long long j = 0; j < n; ++j)
+                x[(o * n + j) * inner + i] = line[j];
+        }
+}
+
+void one_dimensional(int kind, int n) {
+    const std::string what = std::string(names[kind]) + " n " + std::to_string(n);
+    const std::vector<double> x = noise(n);
+    const auto want = reference::r2r(kind, {x.begin(), x.end()});
+
+    std::vector<double> in = x, out(n);
+    fftw_plan p = fftw_plan_r2r_1d(n, in.data(), out.data(), static_cast<fftw_r2r_kind>(kind),
+                                   FFTW_ESTIMATE);
+    if (!p) {
+        expect(1, 0, what + " has no plan");
+        return;
+    }
+    fftw_execute(p);
+    fftw_destroy_plan(p);
+    expect(difference(want, out.data()), tolerance, what);
+
+    std::vector<double> buffer = x;
+    p = fftw_plan_r2r_1d(n, buffer.data(), buffer.data(), static_cast<fftw_r2r_kind>(kind),
+                         FFTW_ESTIMATE);
+    if (!p) {
+        expect(1, 0, what + " has no in-place plan");
+        return;
+    }
+    fftw_execute(p);
+    fftw_destroy_plan(p);
+    expect(difference(want, buffer.data()), tolerance, what + " in place");
+
+    std::vector<float> in_float(x.begin(), x.end()), out_float(n);
+    fftwf_plan q = fftwf_plan_r2r_1d(n, in_float.data(), out_float.data(),
+                                     static_cast<fftwf_r2r_kind>(kind), FFTW_ESTIMATE);
+    if (!q) {
+        expect(1, 0, what + " has no float plan");
+        return;
+    }
+    fftwf_execute(q);
+    fftwf_destroy_plan(q);
+    expect(difference(want, out_float.data()), float_tolerance, what + " float");
+}
+
+void multi_dimensional(const std::vector<int> &dims, const std::vector<fftw_r2r_kind> &kinds) {
+    std::string what = "r2r";
+    for (size_t d = 0; d < dims.size(); ++d)
+        what += std::string(" ") + names[kinds[d]] + " " + std::to_string(dims[d]);
+    size_t total = 1;
+    for (int d : dims)
+        total *= static_cast<size_t>(d);
+    const std::vector<double> x = noise(total);
+    std::vector<long double> want(x.begin(), x.end());
+    for (size_t axis = 0; axis < dims.size(); ++axis)
+        along(want, dims, axis, kinds[axis]);
+
+    std::vector<double> in = x, out(total);
+    fftw_plan p = fftw_plan_r2r(static_cast<int>(dims.size()), dims.data(), in.data(), out.data(),
+                                kinds.data(), FFTW_ESTIMATE);
+    if (!p) {
+        expect(1, 0, what + " has no plan");
+        return;
+    }
+    fftw_execute(p);
+    fftw_destroy_plan(p);
+    expect(difference(want, out.data()), tolerance, what);
+}
+
+// howmany DCT-IIs of n, interleaved: element stride howmany, transforms 1 apart
+void many(int n, int howmany) {
+    const std::vector<double> x = noise(static_cast<size_t>(n) * howmany);
+    std::vector<double> in = x, out(x.size());
+    const fftw_r2r_kind kind = FFTW_REDFT10;
+    fftw_plan p = fftw_plan_many_r2r(1, &n, howmany, in.data(), nullptr, howmany, 1, out.data(),
+                                     nullptr, howmany, 1, &kind, FFTW_ESTIMATE);
+    if (!p) {
+        expect(1, 0, "many_r2r has no plan");
+        return;
+    }
+    fftw_execute(p);
+    fftw_destroy_plan(p);
+
+    reference::error e;
+    std::vector<long double> line(static_cast<size_t>(n));
+    for (int b = 0; b < howmany; ++b) {
+        for (int j = 0; j < n; ++j)
+            line[j] = x[static_cast<size_t>(j) * howmany + b];
+        const auto want = reference::r2r(kind, line);
+        for (int j = 0; j < n; ++j)
+            e.add(want[j], out[static_cast<size_t>(j) * howmany + b]);
+    }
+    expect(e.relative(), tolerance, "many_r2r REDFT10 n " + std::to_string(n) + " interleaved");
+}
+
+} // namespace
+
+int main() {
+    const int sizes[] = {1,  2,  3,  4,   5,   6,   7,   8,   9,   10,  12,  15,  16,
+                         17, 31, 32, 60,  63,  64,  97,  100, 127, 128, 255, 256, 480};
+    for (int kind = FFTW_R2HC; kind <= FFTW_RODFT11; ++kind)
+        for (int n : sizes) {
+            if (kind == FFTW_REDFT00 && n < 2) // defined from n = 2
+                continue;
+            one_dimensional(kind, n);
+        }
+
+    multi_dimensional({6, 10}, {FFTW_REDFT10, FFTW_RODFT01});
+    multi_dimensional({17, 8}, {FFTW_REDFT00, FFTW_RODFT11});
+    multi_dimensional({5, 6, 7}, {FFTW_RODFT00, FFTW_REDFT11, FFTW_DHT});
+    many(40, 13);
+
+    if (failures) {
+        std::println(stderr, "{} r2r transforms disagree with the direct sums", failures);
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
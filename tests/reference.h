@@ -0,0 +1,150 @@
+// Direct transforms in long double, which the engine tests compare against. A bin costs O(n),
+// so small sizes check every output and large ones a fixed sample of outputs.
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <complex>
+#include <numbers>
+#include <random>
+#include <vector>
+
+namespace reference {
+
+using complex = std::complex<long double>;
+
+inline constexpr long double pi = std::numbers::pi_v<long double>;
+
+// Sizes up to this are checked at every output
+inline constexpr long long every_bin = 4096;
+
+// Unnormalised DFT of n values, a bin at a time, off a table of the n roots of unity
+class dft {
+  public:
+    dft(long long n, int sign) : n_(n), roots_(static_cast<size_t>(n)) {
+        for (long long m = 0; m < n; ++m) {
+            const long double angle = sign * 2 * pi * static_cast<long double>(m) / n;
+            roots_[m] = {std::cos(angle), std::sin(angle)};
+        }
+    }
+
+    // Bin k of x[0], x[stride], ..., x[(n - 1) stride]
+    template <typename V>
+    complex bin(const V *x, long long k, long long stride = 1) const {
+        complex sum = 0;
+        long long m = 0;
+        for (long long j = 0; j < n_; ++j) {
+            sum += complex(x[j * stride]) * roots_[m];
+            m += k;
+            if (m >= n_)
+                m -= n_;
+        }
+        return sum;
+    }
+
+  private:
+    long long n_;
+    std::vector<complex> roots_;
+};
+
+// The outputs to check out of n: all of them, or the ends, the middle and a random few
+inline std::vector<long long> bins(long long n) {
+    std::vector<long long> k;
+    if (n <= every_bin) {
+        for (long long i = 0; i < n; ++i)
+            k.push_back(i);
+        return k;
+    }
+    k = {0, 1, 2, 3, n / 2 - 1, n / 2, n / 2 + 1, n - 3, n - 2, n - 1};
+    std::mt19937_64 random(static_cast<unsigned long long>(n));
+    for (int i = 0; i < 16; ++i)
+        k.push_back(static_cast<long long>(random() % static_cast<unsigned long long>(n)));
+    return k;
+}
+
+// Worst difference from the reference, relative to its largest magnitude
+class error {
+  public:
+    void add(complex want, complex got) {
+        worst_ = std::max(worst_, std::abs(want - got));
+        largest_ = std::max(largest_, std::abs(want));
+    }
+
+    double relative() const {
+        return static_cast<double>(largest_ > 0 ? worst_ / largest_ : worst_);
+    }
+
+  private:
+    long double worst_ = 0;
+    long double largest_ = 0;
+};
+
+// FFTW's r2r kinds, numbered as in keyq.h, unnormalised as FFTW defines them
+inline std::vector<long double> r2r(int kind, const std::vector<long double> &x) {
+    const long long n = static_cast<long long>(x.size());
+    std::vector<long double> y(x.size());
+    for (long long k = 0; k < n; ++k) {
+        long double sum = 0;
+        const auto sign = [](long long i) { return i % 2 ? -1.0L : 1.0L; };
+        switch (kind) {
+        case 0: // R2HC: real parts up to n/2, then the imaginary parts backwards
+            for (long long j = 0; j < n; ++j)
+                sum += k <= n / 2 ? x[j] * std::cos(2 * pi * j * k / n)
+                                  : -x[j] * std::sin(2 * pi * j * (n - k) / n);
+            break;
+        case 1: // HC2R
+            sum = x[0];
+            for (long long j = 1; j < n; ++j) {
+                if (j < n - j)
+                    sum += 2 * (x[j] * std::cos(2 * pi * j * k / n) -
+                                x[n - j] * std::sin(2 * pi * j * k / n));
+                else if (j == n - j)
+                    sum += x[j] * sign(k);
+            }
+            break;
+        case 2: // DHT
+            for (long long j = 0; j < n; ++j)
+                sum += x[j] * (std::cos(2 * pi * j * k / n) + std::sin(2 * pi * j * k / n));
+            break;
+        case 3: // REDFT00
+            sum = x[0] + sign(k) * x[n - 1];
+            for (long long j = 1; j < n - 1; ++j)
+                sum += 2 * x[j] * std::cos(pi * j * k / (n - 1));
+            break;
+        case 4: // REDFT01
+            sum = x[0];
+            for (long long j = 1; j < n; ++j)
+                sum += 2 * x[j] * std::cos(pi * j * (k + 0.5L) / n);
+            break;
+        case 5: // REDFT10
+            for (long long j = 0; j < n; ++j)
+                sum += 2 * x[j] * std::cos(pi * (j + 0.5L) * k / n);
+            break;
+        case 6: // REDFT11
+            for (long long j = 0; j < n; ++j)
+                sum += 2 * x[j] * std::cos(pi * (j + 0.5L) * (k + 0.5L) / n);
+            break;
+        case 7: // RODFT00
+            for (long long j = 0; j < n; ++j)
+                sum += 2 * x[j] * std::sin(pi * (j + 1) * (k + 1) / (n + 1));
+            break;
+        case 8: // RODFT01
+            sum = sign(k) * x[n - 1];
+            for (long long j = 0; j < n - 1; ++j)
+                sum += 2 * x[j] * std::sin(pi * (j + 1) * (k + 0.5L) / n);
+            break;
+        case 9: // RODFT10
+            for (long long j = 0; j < n; ++j)
+                sum += 2 * x[j] * std::sin(pi * (j + 0.5L) * (k + 1) / n);
+            break;
+        case 10: // RODFT11
+            for (long long j = 0; j < n; ++j)
+                sum += 2 * x[j] * std::sin(pi * (j + 0.5L) * (k + 0.5L) / n);
+            break;
+        }
+        y[k] = sum;
+    }
+    return y;
+}
+
+} // namespace reference
@@ -0,0 +1,74 @@
+// Stress test for triple_buffer: a producer publishes numbered frames as fast as it can while
+// a consumer reads them. Every frame the consumer sees must be one that was published whole,
+// and never older than the one before. Built with KEYQ_TSAN, ThreadSanitizer also checks
+// that the hand-off orders the slot writes before the reads.
+#include "triple_buffer.h"
+
+#include <array>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <print>
+#include <thread>
+
+namespace {
+
+struct frame {
+    uint64_t sequence = 0;
+    std::array<uint64_t, 255> values{}; // each a function of sequence and position
+};
+
+uint64_t expected(uint64_t sequence, size_t i) {
+    return sequence * 0x9e3779b97f4a7c15ull + i;
+}
+
+void fill(frame &f, uint64_t sequence) {
+    f.sequence = sequence;
+    for (size_t i = 0; i < f.values.size(); ++i)
+        f.values[i] = expected(sequence, i);
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    const uint64_t frames = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 200000;
+
+    // Frame 0 is the initial value, which the consumer sees until the first publish
+    frame initial;
+    fill(initial, 0);
+    keyq::triple_buffer<frame> buffer(initial);
+    std::thread producer([&] {
+        for (uint64_t s = 1; s <= frames; ++s) {
+            fill(buffer.write_buffer(), s);
+            buffer.publish();
+        }
+    });
+
+    uint64_t last = 0;
+    uint64_t reads = 0;
+    uint64_t distinct = 0;
+    int failures = 0;
+    while (last < frames && failures == 0) {
+        const frame &f = buffer.read();
+        ++reads;
+        if (f.sequence < last) {
+            std::println(stderr, "frame {} read after frame {}", f.sequence, last);
+            ++failures;
+        }
+        for (size_t i = 0; i < f.values.size(); ++i) {
+            if (f.values[i] != expected(f.sequence, i)) {
+                std::println(stderr, "frame {} torn at value {}", f.sequence, i);
+                ++failures;
+                break;
+            }
+        }
+        if (f.sequence != last)
+            ++distinct;
+        last = f.sequence;
+    }
+    producer.join();
+
+    std::println("{} frames published, {} reads, {} distinct frames seen", frames, reads,
+                 distinct);
+    return failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}